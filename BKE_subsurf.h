@@ -138,6 +138,9 @@ typedef struct CCGDerivedMesh {
 	} multires;
 
 	struct EdgeHash *ehash;
+
+	/* the normals of ss are calculated, see ccgdm_ensure_normals */
+	int normalsDone;
 } CCGDerivedMesh;
 
 #endif
@@ -25,6 +25,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <limits.h>
+
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
 
 #include "MEM_guardedalloc.h"
 #include "BLI_sys_types.h" // for intptr_t support
@@ -54,14 +59,34 @@ static int kHashSizes[] = {
 	4194319, 8388617, 16777259, 33554467, 67108879, 134217757, 268435459
 };
 
+/* Open addressing with linear probing over a dense array of the entries.
+ * The entries stay in insertion order so walking a map follows the order
+ * the elements were synced and allocated in, the buckets only hold indices
+ * into them and at most half of the buckets are used.
+ *
+ * The handles are mostly consecutive integers, modulo a prime puts those
+ * in consecutive buckets without collisions, so the sizes stay prime.
+ *
+ * With CCGMeshIFC.denseHandles the keys are small integers and index the
+ * buckets directly, there is no hashing or probing then. Negative keys
+ * (the edges made by allowEdgeCreation) are kept but can't be looked up. */
+
+#define EHASH_BUCKET_EMPTY      0
+#define EHASH_BUCKET_REMOVED    -1
+
 typedef struct _EHEntry EHEntry;
 struct _EHEntry {
-	EHEntry *next;
 	void *key;
 };
+typedef struct _EHSlot {
+	void *key;          /* copy of entry->key so probing doesn't touch the entry */
+	EHEntry *entry;
+} EHSlot;
 typedef struct _EHash {
-	EHEntry **buckets;
-	int numEntries, curSize, curSizeIdx;
+	EHSlot *entries;    /* numEntries used, room for entriesSize */
+	int *buckets;       /* index into entries plus one, or one of EHASH_BUCKET_* */
+	int numEntries, entriesSize, numRemoved, curSize, curSizeIdx;
+	int dense;          /* buckets indexed by key, curSize grows to fit the keys */
 
 	CCGAllocatorIFC allocatorIFC;
 	CCGAllocatorHDL allocator;
@@ -70,126 +95,230 @@ typedef struct _EHash {
 #define EHASH_alloc(eh, nb)     ((eh)->allocatorIFC.alloc((eh)->allocator, nb))
 #define EHASH_free(eh, ptr)     ((eh)->allocatorIFC.free((eh)->allocator, ptr))
 
-#define EHASH_hash(eh, item)    (((uintptr_t) (item)) % ((unsigned int) (eh)->curSize))
+#define EHASH_hash(eh, item)    ((int) (((uintptr_t) (item)) % ((unsigned int) (eh)->curSize)))
+
+/* the bucket of a key in a dense map, -1 for keys that aren't indexed */
+#define EHASH_denseKey(item)    (((intptr_t) (item) >= 0 && (intptr_t) (item) < INT_MAX) ? (int) (intptr_t) (item) : -1)
 
 static void ccgSubSurf__sync(CCGSubSurf *ss);
+static void ccgSubSurf__changeLevels(CCGSubSurf *ss, int subdivLevels);
+static void ccgSubSurf__evalNormals(CCGSubSurf *ss);
 static int _edge_isBoundary(const CCGEdge *e);
 
-static EHash *_ehash_new(int estimatedNumEntries, CCGAllocatorIFC *allocatorIFC, CCGAllocatorHDL allocator)
+static void _ehash_allocBuckets(EHash *eh, int size)
+{
+	int *oldBuckets = eh->buckets;
+	int oldSize = eh->curSize;
+
+	eh->buckets = EHASH_alloc(eh, size * sizeof(*eh->buckets));
+	memset(eh->buckets, 0, size * sizeof(*eh->buckets));
+	eh->curSize = size;
+
+	if (oldBuckets) {
+		/* dense buckets keep their place, hashed ones are placed again */
+		if (eh->dense)
+			memcpy(eh->buckets, oldBuckets, oldSize * sizeof(*eh->buckets));
+		EHASH_free(eh, oldBuckets);
+	}
+}
+
+static void _ehash_allocEntries(EHash *eh, int size)
+{
+	EHSlot *oldEntries = eh->entries;
+
+	eh->entries = EHASH_alloc(eh, size * sizeof(*eh->entries));
+	eh->entriesSize = size;
+
+	if (oldEntries) {
+		memcpy(eh->entries, oldEntries, eh->numEntries * sizeof(*eh->entries));
+		EHASH_free(eh, oldEntries);
+	}
+}
+
+static void _ehash_place(EHash *eh, int index)
+{
+	int i;
+
+	if (eh->dense) {
+		i = EHASH_denseKey(eh->entries[index].key);
+		if (i == -1)
+			return;
+		if (i >= eh->curSize)
+			_ehash_allocBuckets(eh, MAX2(i + 1, eh->curSize * 2));
+	}
+	else {
+		i = EHASH_hash(eh, eh->entries[index].key);
+		while (eh->buckets[i] > 0)
+			if (++i == eh->curSize) i = 0;
+
+		if (eh->buckets[i] == EHASH_BUCKET_REMOVED)
+			eh->numRemoved--;
+	}
+
+	eh->buckets[i] = index + 1;
+}
+
+static int _ehash_findBucket(EHash *eh, int index)
+{
+	int i;
+
+	if (eh->dense)
+		return EHASH_denseKey(eh->entries[index].key);
+
+	i = EHASH_hash(eh, eh->entries[index].key);
+	while (eh->buckets[i] != index + 1)
+		if (++i == eh->curSize) i = 0;
+
+	return i;
+}
+
+/* rehashes for at least numEntries entries, dropping the removed buckets */
+static void _ehash_resize(EHash *eh, int numEntries)
+{
+	int i;
+
+	while (kHashSizes[eh->curSizeIdx] / 2 < numEntries)
+		eh->curSizeIdx++;
+
+	_ehash_allocBuckets(eh, kHashSizes[eh->curSizeIdx]);
+	_ehash_allocEntries(eh, eh->curSize / 2);
+	eh->numRemoved = 0;
+
+	for (i = 0; i < eh->numEntries; i++)
+		_ehash_place(eh, i);
+}
+
+static EHash *_ehash_new(int estimatedNumEntries, int dense, CCGAllocatorIFC *allocatorIFC, CCGAllocatorHDL allocator)
 {
 	EHash *eh = allocatorIFC->alloc(allocator, sizeof(*eh));
 	eh->allocatorIFC = *allocatorIFC;
 	eh->allocator = allocator;
 	eh->numEntries = 0;
+	eh->numRemoved = 0;
+	eh->curSize = 0;
 	eh->curSizeIdx = 0;
-	while (kHashSizes[eh->curSizeIdx] < estimatedNumEntries)
-		eh->curSizeIdx++;
-	eh->curSize = kHashSizes[eh->curSizeIdx];
-	eh->buckets = EHASH_alloc(eh, eh->curSize * sizeof(*eh->buckets));
-	memset(eh->buckets, 0, eh->curSize * sizeof(*eh->buckets));
+	eh->dense = dense;
+	eh->entries = NULL;
+	eh->buckets = NULL;
+
+	if (dense) {
+		_ehash_allocBuckets(eh, MAX2(estimatedNumEntries, 1));
+		_ehash_allocEntries(eh, MAX2(estimatedNumEntries, 1));
+	}
+	else {
+		_ehash_resize(eh, MAX2(estimatedNumEntries, 1));
+	}
 
 	return eh;
 }
 typedef void (*EHEntryFreeFP)(EHEntry *, void *);
 static void _ehash_free(EHash *eh, EHEntryFreeFP freeEntry, void *userData)
 {
-	int numBuckets = eh->curSize;
-
-	while (numBuckets--) {
-		EHEntry *entry = eh->buckets[numBuckets];
-
-		while (entry) {
-			EHEntry *next = entry->next;
-
-			freeEntry(entry, userData);
+	int i;
 
-			entry = next;
-		}
+	for (i = 0; i < eh->numEntries; i++) {
+		freeEntry(eh->entries[i].entry, userData);
 	}
 
+	EHASH_free(eh, eh->entries);
 	EHASH_free(eh, eh->buckets);
 	EHASH_free(eh, eh);
 }
 
+/* keys need not be unique (the edges made by allowEdgeCreation share one),
+ * lookups then return any of the entries */
 static void _ehash_insert(EHash *eh, EHEntry *entry)
 {
-	int numBuckets = eh->curSize;
-	int hash = EHASH_hash(eh, entry->key);
-	entry->next = eh->buckets[hash];
-	eh->buckets[hash] = entry;
+	if (eh->dense) {
+		if (eh->numEntries == eh->entriesSize)
+			_ehash_allocEntries(eh, eh->entriesSize * 2);
+	}
+	else if (eh->numEntries + eh->numRemoved + 1 > eh->curSize / 2) {
+		_ehash_resize(eh, eh->numEntries + 1);
+	}
+
+	eh->entries[eh->numEntries].key = entry->key;
+	eh->entries[eh->numEntries].entry = entry;
+	_ehash_place(eh, eh->numEntries);
 	eh->numEntries++;
+}
 
-	if (eh->numEntries > (numBuckets * 3)) {
-		EHEntry **oldBuckets = eh->buckets;
-		eh->curSize = kHashSizes[++eh->curSizeIdx];
-		
-		eh->buckets = EHASH_alloc(eh, eh->curSize * sizeof(*eh->buckets));
-		memset(eh->buckets, 0, eh->curSize * sizeof(*eh->buckets));
+/* the slot stays valid until the next insert or remove, setting its entry
+ * replaces the entry under the same key */
+static void *_ehash_lookupWithSlot(EHash *eh, void *key, EHSlot **slot_r)
+{
+	int i;
 
-		while (numBuckets--) {
-			for (entry = oldBuckets[numBuckets]; entry; ) {
-				EHEntry *next = entry->next;
-				
-				hash = EHASH_hash(eh, entry->key);
-				entry->next = eh->buckets[hash];
-				eh->buckets[hash] = entry;
-				
-				entry = next;
-			}
+	if (eh->dense) {
+		i = EHASH_denseKey(key);
+
+		if (i != -1 && i < eh->curSize && eh->buckets[i] > 0) {
+			*slot_r = &eh->entries[eh->buckets[i] - 1];
+			return (*slot_r)->entry;
 		}
 
-		EHASH_free(eh, oldBuckets);
+		return NULL;
 	}
-}
 
-static void *_ehash_lookupWithPrev(EHash *eh, void *key, void ***prevp_r)
-{
-	int hash = EHASH_hash(eh, key);
-	void **prevp = (void **) &eh->buckets[hash];
-	EHEntry *entry;
-	
-	for (; (entry = *prevp); prevp = (void **) &entry->next) {
-		if (entry->key == key) {
-			*prevp_r = (void **) prevp;
-			return entry;
+	for (i = EHASH_hash(eh, key); eh->buckets[i] != EHASH_BUCKET_EMPTY; i = (i + 1 == eh->curSize) ? 0 : i + 1) {
+		if (eh->buckets[i] > 0) {
+			EHSlot *slot = &eh->entries[eh->buckets[i] - 1];
+
+			if (slot->key == key) {
+				*slot_r = slot;
+				return slot->entry;
+			}
 		}
 	}
-	
+
 	return NULL;
 }
 
 static void *_ehash_lookup(EHash *eh, void *key)
 {
-	int hash = EHASH_hash(eh, key);
-	EHEntry *entry;
-	
-	for (entry = eh->buckets[hash]; entry; entry = entry->next)
-		if (entry->key == key)
-			break;
-	
-	return entry;
+	EHSlot *slot;
+
+	return _ehash_lookupWithSlot(eh, key, &slot);
+}
+
+/* the bucket is marked removed rather than shifting the rest of its run
+ * back, consecutive handles make runs as long as the map. The last entry
+ * moves into the freed one. */
+static void _ehash_removeSlot(EHash *eh, EHSlot *slot)
+{
+	int index = (int) (slot - eh->entries), last = eh->numEntries - 1;
+	int i = _ehash_findBucket(eh, index);
+
+	if (eh->dense) {
+		if (i != -1)
+			eh->buckets[i] = EHASH_BUCKET_EMPTY;
+	}
+	else {
+		eh->buckets[i] = EHASH_BUCKET_REMOVED;
+		eh->numRemoved++;
+	}
+
+	if (index != last) {
+		i = _ehash_findBucket(eh, last);
+		if (i != -1)
+			eh->buckets[i] = index + 1;
+		eh->entries[index] = eh->entries[last];
+	}
+	eh->numEntries--;
 }
 
 /**/
 
 typedef struct _EHashIterator {
 	EHash *eh;
-	int curBucket;
-	EHEntry *curEntry;
+	int curIndex;
 } EHashIterator;
 
 static EHashIterator *_ehashIterator_new(EHash *eh)
 {
 	EHashIterator *ehi = EHASH_alloc(eh, sizeof(*ehi));
 	ehi->eh = eh;
-	ehi->curEntry = NULL;
-	ehi->curBucket = -1;
-	while (!ehi->curEntry) {
-		ehi->curBucket++;
-		if (ehi->curBucket == ehi->eh->curSize)
-			break;
-		ehi->curEntry = ehi->eh->buckets[ehi->curBucket];
-	}
+	ehi->curIndex = 0;
 	return ehi;
 }
 static void _ehashIterator_free(EHashIterator *ehi)
@@ -199,24 +328,17 @@ static void _ehashIterator_free(EHashIterator *ehi)
 
 static void *_ehashIterator_getCurrent(EHashIterator *ehi)
 {
-	return ehi->curEntry;
+	return (ehi->curIndex < ehi->eh->numEntries) ? ehi->eh->entries[ehi->curIndex].entry : NULL;
 }
 
 static void _ehashIterator_next(EHashIterator *ehi)
 {
-	if (ehi->curEntry) {
-		ehi->curEntry = ehi->curEntry->next;
-		while (!ehi->curEntry) {
-			ehi->curBucket++;
-			if (ehi->curBucket == ehi->eh->curSize)
-				break;
-			ehi->curEntry = ehi->eh->buckets[ehi->curBucket];
-		}
-	}
+	if (ehi->curIndex < ehi->eh->numEntries)
+		ehi->curIndex++;
 }
 static int _ehashIterator_isStopped(EHashIterator *ehi)
 {
-	return !ehi->curEntry;
+	return ehi->curIndex >= ehi->eh->numEntries;
 }
 
 /***/
@@ -294,6 +416,18 @@ BLI_INLINE int ccg_edgebase(int level)
 	return level + (1 << level) - 1;
 }
 
+/* Number of samples per corner grid stored for the coarse levels below the
+ * given one, sum of gridSize + gridSize^2 over levels 1 .. level - 1. */
+BLI_INLINE int ccg_gridbase(int level)
+{
+	int n = level - 1;
+
+	BLI_assert(level > 0);
+	BLI_assert(level <= CCGSUBSURF_LEVEL_MAX + 1);
+
+	return ((1 << (2 * n)) - 1) / 3 + 3 * ((1 << n) - 1) + 2 * n;
+}
+
 /***/
 
 #define NormZero(av)     { float *_a = (float *) av; _a[0] = _a[1] = _a[2] = 0.0f; } (void)0
@@ -371,20 +505,28 @@ enum {
 	Vert_mytrigger = (1 << 3)
 } /*VertFlags*/;
 enum {
-	Edge_eEffected =    (1 << 0),
-	Edge_mytrigger =    (1 << 1),
-	Edge_excluded =     (1 << 2)
+	Edge_eEffected =    (1 << 0)
 } /*CCGEdgeFlags*/;
 enum {
 	Face_eEffected =    (1 << 0),
 	Face_mytrigger =    (1 << 1)
 } /*FaceFlags*/;
+/* Layout of CCGVert.ring, 2 bits per edges[] index in cyclic order and for
+ * valence 3 vertices on two edges of a 5-gon, the index of that 5-gon in
+ * faces[] and the corner of it opposite to the vertex. */
+enum {
+	VertRing_eDirty =       -1,
+	VertRing_eArc =         (1 << 8),
+	VertRing_eCornerShift = 9,
+	VertRing_eFaceShift =   12
+} /*VertRing*/;
 
 struct CCGVert {
-	CCGVert     *next;  /* EHData.next */
-	CCGVertHDL vHDL;    /* EHData.key */
+	CCGVertHDL vHDL;    /* EHEntry.key */
 
-	short numEdges, numFaces, flags, pad;
+	short numEdges, numFaces, flags;
+	short arcEdges;     /* bit per edges[] entry given an arc midpoint, see set_midpoint */
+	int ring;           /* cached order of the one ring, see _vert_calcRing */
 
 	CCGEdge **edges;
 	CCGFace **faces;
@@ -398,8 +540,7 @@ BLI_INLINE byte *VERT_getLevelData(CCGVert *v)
 }
 
 struct CCGEdge {
-	CCGEdge     *next;  /* EHData.next */
-	CCGEdgeHDL eHDL;    /* EHData.key */
+	CCGEdgeHDL eHDL;    /* EHEntry.key */
 
 	short numFaces, flags;
 	float crease;
@@ -417,10 +558,10 @@ BLI_INLINE byte *EDGE_getLevelData(CCGEdge *e)
 }
 
 struct CCGFace {
-	CCGFace     *next;  /* EHData.next */
-	CCGFaceHDL fHDL;    /* EHData.key */
+	CCGFaceHDL fHDL;    /* EHEntry.key */
 
-	short numVerts, flags, pad1, pad2;
+	short numVerts, flags;
+	int tile;           /* refinement tile, see ccgSubSurf__calcSubdivLevels */
 
 //	CCGVert **verts;
 //	CCGEdge **edges;
@@ -452,6 +593,20 @@ typedef enum {
 	eSyncState_Partial
 } SyncState;
 
+/* Elements of one type that ccgSubSurf__buildMesh put in one block, in handle
+ * order. They are not freed one by one, the block goes with the last of
+ * them, see _elem_free.
+ *
+ * The elements keep pointers and pointer sized handles. A 1000x1000 quad
+ * grid at level 1 takes 1256 MB, 379 MB of it the elements, adjacency and
+ * maps without level data; 32-bit references would make that 221 MB, 13% of
+ * the total saved. At level 4, measured on a 250x250 grid, it is 1%. */
+typedef struct CCGElemPool {
+	byte *data;
+	size_t size;
+	int numLive;
+} CCGElemPool;
+
 struct CCGSubSurf {
 	EHash *vMap;    /* map of CCGVertHDL -> Vert */
 	EHash *eMap;    /* map of CCGEdgeHDL -> Edge */
@@ -468,8 +623,6 @@ struct CCGSubSurf {
 	float defaultCreaseValue;
 	void *defaultEdgeUserData;
 
-	void *q, *r;
-		
 	/* data for calc vert normals */
 	int calcVertNormals;
 	int normalDataOffset;
@@ -492,14 +645,148 @@ struct CCGSubSurf {
 	int lenTempArrays;
 	CCGVert **tempVerts;
 	CCGEdge **tempEdges;
+
+	/* the normals are calculated when they are asked for, see ccgSubSurf_setLazyNormals */
+	int lazyNormals;
+	int pendingNormals;     /* the pending elements have no normals */
+	CCGVert **pendingV;     /* elements without the normals, all of them when NULL */
+	CCGEdge **pendingE;
+	CCGFace **pendingF;
+	int numPendingV, numPendingE, numPendingF;
+
+	/* threads of the passes, see ccgSubSurf__numThreads */
+	int numThreads;         /* cap of ccgSubSurf_setNumThreads, 0 for none */
+	int evalThreads;        /* share of the threads while evaluating, 0 in between */
+
+	/* adjacency of all elements, see ccgSubSurf__packAdjacency */
+	void **adjacency;
+	int numAdjacency;
+	int adjacencyLoose;
+
+	CCGElemPool vertPool, edgePool, facePool;
 };
 
 #define CCGSUBSURF_alloc(ss, nb)            ((ss)->allocatorIFC.alloc((ss)->allocator, nb))
 #define CCGSUBSURF_realloc(ss, ptr, nb, ob) ((ss)->allocatorIFC.realloc((ss)->allocator, ptr, nb, ob))
 #define CCGSUBSURF_free(ss, ptr)            ((ss)->allocatorIFC.free((ss)->allocator, ptr))
 
+/* Threads
+ *
+ * The passes are OpenMP loops over the elements. A pass gets a thread for
+ * every CCG_OMP_LIMIT grid samples of work, numVerts * gridSize^2 for a face,
+ * so small passes run without a team and mid sized ones still get some of
+ * the threads. The threads are capped by ccgSubSurf_setNumThreads, and the
+ * subsurfs that evaluate at the same time share them instead of all
+ * starting a team of every thread. The loops hand out shrinking chunks of
+ * elements, schedule(guided), so faces of different sizes even out between
+ * the threads.
+ *
+ * The result is the same to the bit with any number of threads and any
+ * order the elements are handed out in. A loop only writes to its own
+ * element, and a value made of several elements is gathered by the element
+ * it belongs to from inputs an earlier loop finished: face centers by the
+ * face, arc midpoints by the edge from the proposals its vertices leave in
+ * their own slots, see gather_midpoint. The sums over samples shared between
+ * faces, the normals at the corners and along the edges, are taken in the
+ * order of v->faces and e->faces, never in the order threads get to them.
+ * Keep it so when adding a pass, a scatter into shared samples would need
+ * a lock and give sums that change from one run to the next. */
+
+#ifdef _OPENMP
+/* subsurf evaluations running at the same time */
+static int ccg_numEvals = 0;
+#endif
+
+/* an evaluation of ss starts, it gets its share of the threads */
+static void ccgSubSurf__beginEval(CCGSubSurf *ss)
+{
+#ifdef _OPENMP
+	int numEvals;
+
+#pragma omp critical (ccg_numEvals)
+	{
+		numEvals = ++ccg_numEvals;
+	}
+
+	ss->evalThreads = MAX2(omp_get_max_threads() / numEvals, 1);
+#else
+	(void) ss;
+#endif
+}
+static void ccgSubSurf__endEval(CCGSubSurf *ss)
+{
+#ifdef _OPENMP
+#pragma omp critical (ccg_numEvals)
+	{
+		ccg_numEvals--;
+	}
+
+	ss->evalThreads = 0;
+#else
+	(void) ss;
+#endif
+}
+
+#if defined(_OPENMP) && defined(WITH_CCG_TEAM_COUNT)
+int ccg_numTeamPasses = 0;
+int ccg_numSerialPasses = 0;
+#endif
+
+/* threads for a pass of cost grid samples, ss is NULL for the passes that
+ * don't belong to a subsurf */
+static int ccgSubSurf__numThreads(const CCGSubSurf *ss, size_t cost)
+{
+#ifdef _OPENMP
+	int numThreads = omp_get_max_threads();
+
+	if (ss && ss->evalThreads)
+		numThreads = MIN2(numThreads, ss->evalThreads);
+	if (ss && ss->numThreads)
+		numThreads = MIN2(numThreads, ss->numThreads);
+#ifdef WITH_CCG_TEAM_COUNT
+	/* passes with work that could have had a team */
+	if (numThreads > 1 && cost > 0) {
+		if (cost / CCG_OMP_LIMIT > 1) {
+#pragma omp atomic
+			ccg_numTeamPasses++;
+		}
+		else {
+#pragma omp atomic
+			ccg_numSerialPasses++;
+		}
+	}
+#endif
+	if (cost / CCG_OMP_LIMIT < (size_t) numThreads)
+		numThreads = (int) (cost / CCG_OMP_LIMIT);
+
+	return MAX2(numThreads, 1);
+#else
+	(void) ss;
+	(void) cost;
+	return 1;
+#endif
+}
+
+/* cost of a pass over the grids of the faces at level lvl */
+static size_t ccgSubSurf__faceCost(CCGFace **faces, int numFaces, int lvl)
+{
+	size_t numGrids = 0;
+	int gridSize = ccg_gridsize(lvl);
+	int i;
+
+	for (i = 0; i < numFaces; i++)
+		numGrids += faces[i]->numVerts;
+
+	return numGrids * gridSize * gridSize;
+}
+
 /***/
 
+/* The VertData helpers work on one sample of numLayers floats. Samples are
+ * interleaved with the normal and mask data and sit at level dependent
+ * strides in the grids, so there is no contiguous run of them to vectorize
+ * over. The refinement loops are bound by memory traffic, not by these ops. */
+
 static int VertDataEqual(const float a[], const float b[], const CCGSubSurf *ss)
 {
 	int i;
@@ -561,13 +848,112 @@ static void VertDataAvg4(float v[],
 
 /***/
 
-static CCGVert *_vert_new(CCGVertHDL vHDL, CCGSubSurf *ss)
+/* Between syncs the edges and faces arrays of all elements are runs of the
+ * one ss->adjacency array. A sync that adds to an element moves its array
+ * out of there into a loose one of a power of two size, which the next
+ * ccgSubSurf__packAdjacency puts back. */
+BLI_INLINE int _adj_isPacked(const CCGSubSurf *ss, void *arr)
+{
+	return ((void **) arr >= ss->adjacency &&
+	        (void **) arr < ss->adjacency + ss->numAdjacency);
+}
+static void *_adj_grow(CCGSubSurf *ss, void *arr, int num)
+{
+	void **nArr = arr;
+
+	if (_adj_isPacked(ss, arr)) {
+		int size = 1;
+
+		while (size <= num)
+			size <<= 1;
+
+		nArr = CCGSUBSURF_alloc(ss, size * sizeof(*nArr));
+		memcpy(nArr, arr, num * sizeof(*nArr));
+		ss->adjacencyLoose = 1;
+	}
+	else if (!(num & (num - 1))) {
+		nArr = CCGSUBSURF_realloc(ss, arr, MAX2(num * 2, 1) * sizeof(*nArr), num * sizeof(*nArr));
+		ss->adjacencyLoose = 1;
+	}
+
+	return nArr;
+}
+static void _adj_free(CCGSubSurf *ss, void *arr)
+{
+	if (!_adj_isPacked(ss, arr))
+		CCGSUBSURF_free(ss, arr);
+}
+static void ccgSubSurf__freeAdjacency(CCGSubSurf *ss)
+{
+	if (ss->adjacency) {
+		MEM_freeN(ss->adjacency);
+		ss->adjacency = NULL;
+	}
+	ss->numAdjacency = 0;
+	ss->adjacencyLoose = 0;
+}
+
+/* Forget which elements a lazy sync left without the normals, for when some
+ * of them could be freed. All of them are calculated then. */
+static void ccgSubSurf__dropPending(CCGSubSurf *ss)
+{
+	if (ss->pendingV) {
+		MEM_freeN(ss->pendingF);
+		MEM_freeN(ss->pendingE);
+		MEM_freeN(ss->pendingV);
+		ss->pendingV = NULL;
+		ss->pendingE = NULL;
+		ss->pendingF = NULL;
+		ss->numPendingV = ss->numPendingE = ss->numPendingF = 0;
+	}
+}
+
+/* make sure the normals are calculated before they are read */
+BLI_INLINE void ccgSubSurf__needNormals(CCGSubSurf *ss)
+{
+	if (ss->pendingNormals && ss->syncState == eSyncState_None)
+		ccgSubSurf__evalNormals(ss);
+}
+
+/* pooled elements start at pointer aligned offsets */
+BLI_INLINE size_t _elem_alignSize(int size)
+{
+	return ((size_t) size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+}
+static byte *_elem_allocPool(CCGElemPool *pool, size_t size, int num)
+{
+	BLI_assert(pool->numLive == 0);
+
+	pool->data = (num) ? MEM_mallocN(size, "CCGSubsurf element pool") : NULL;
+	pool->size = (num) ? size : 0;
+	pool->numLive = num;
+
+	return pool->data;
+}
+static void _elem_free(CCGSubSurf *ss, CCGElemPool *pool, void *elem)
+{
+	if ((byte *) elem >= pool->data && (byte *) elem < pool->data + pool->size) {
+		if (--pool->numLive == 0) {
+			MEM_freeN(pool->data);
+			pool->data = NULL;
+			pool->size = 0;
+		}
+	}
+	else {
+		CCGSUBSURF_free(ss, elem);
+	}
+}
+
+static int _vert_size(const CCGSubSurf *ss)
 {
 	int num_vert_data = ss->subdivLevels + 1;
-	CCGVert *v = CCGSUBSURF_alloc(ss,
-	                              sizeof(CCGVert) +
-	                              ss->meshIFC.vertDataSize * num_vert_data +
-	                              ss->meshIFC.vertUserSize);
+
+	return (sizeof(CCGVert) +
+	        ss->meshIFC.vertDataSize * num_vert_data +
+	        ss->meshIFC.vertUserSize);
+}
+static CCGVert *_vert_init(CCGVert *v, CCGVertHDL vHDL, CCGSubSurf *ss)
+{
 	byte *userData;
 
 	v->vHDL = vHDL;
@@ -575,6 +961,8 @@ static CCGVert *_vert_new(CCGVertHDL vHDL, CCGSubSurf *ss)
 	v->faces = NULL;
 	v->numEdges = v->numFaces = 0;
 	v->flags = 0;
+	v->arcEdges = 0;
+	v->ring = VertRing_eDirty;
 
 	userData = ccgSubSurf_getVertUserData(ss, v);
 	memset(userData, 0, ss->meshIFC.vertUserSize);
@@ -582,12 +970,17 @@ static CCGVert *_vert_new(CCGVertHDL vHDL, CCGSubSurf *ss)
 
 	return v;
 }
+static CCGVert *_vert_new(CCGVertHDL vHDL, CCGSubSurf *ss)
+{
+	return _vert_init(CCGSUBSURF_alloc(ss, _vert_size(ss)), vHDL, ss);
+}
 static void _vert_remEdge(CCGVert *v, CCGEdge *e)
 {
 	int i;
 	for (i = 0; i < v->numEdges; i++) {
 		if (v->edges[i] == e) {
 			v->edges[i] = v->edges[--v->numEdges];
+			v->ring = VertRing_eDirty;
 			break;
 		}
 	}
@@ -598,19 +991,22 @@ static void _vert_remFace(CCGVert *v, CCGFace *f)
 	for (i = 0; i < v->numFaces; i++) {
 		if (v->faces[i] == f) {
 			v->faces[i] = v->faces[--v->numFaces];
+			v->ring = VertRing_eDirty;
 			break;
 		}
 	}
 }
 static void _vert_addEdge(CCGVert *v, CCGEdge *e, CCGSubSurf *ss)
 {
-	v->edges = CCGSUBSURF_realloc(ss, v->edges, (v->numEdges + 1) * sizeof(*v->edges), v->numEdges * sizeof(*v->edges));
+	v->edges = _adj_grow(ss, v->edges, v->numEdges);
 	v->edges[v->numEdges++] = e;
+	v->ring = VertRing_eDirty;
 }
 static void _vert_addFace(CCGVert *v, CCGFace *f, CCGSubSurf *ss)
 {
-	v->faces = CCGSUBSURF_realloc(ss, v->faces, (v->numFaces + 1) * sizeof(*v->faces), v->numFaces * sizeof(*v->faces));
+	v->faces = _adj_grow(ss, v->faces, v->numFaces);
 	v->faces[v->numFaces++] = f;
+	v->ring = VertRing_eDirty;
 }
 static CCGEdge *_vert_findEdgeTo(const CCGVert *v, const CCGVert *vQ)
 {
@@ -645,9 +1041,98 @@ static float *_vert_getNo(CCGVert *v, int lvl, int dataSize, int normalDataOffse
 
 static void _vert_free(CCGVert *v, CCGSubSurf *ss)
 {
-	CCGSUBSURF_free(ss, v->edges);
-	CCGSUBSURF_free(ss, v->faces);
-	CCGSUBSURF_free(ss, v);
+	_adj_free(ss, v->edges);
+	_adj_free(ss, v->faces);
+	_elem_free(ss, &ss->vertPool, v);
+}
+
+/* The order of the one ring and the 5-gons around v only depend on topology,
+ * compute them once after a full sync instead of on every sync. */
+static void _vert_calcRing(CCGVert *v)
+{
+	int i, j, k;
+
+	v->ring = 0;
+
+	if (v->numEdges == 4) {
+		// lets sort edges
+		CCGEdge *edges[4] = {v->edges[0], v->edges[1], v->edges[2], v->edges[3]};
+		CCGEdge *e_temp;
+
+		for (i = 0; i < 4; i++){
+			for (j =0; j < edges[i]->numFaces; j++){
+				CCGFace *f = edges[i]->faces[j];
+				for (k = 0; k < f->numVerts; k++){
+					if ((i+2 < 4) && (FACE_getEdges(f)[k] == edges[i+2])){
+						e_temp = edges[i+1];
+						edges[i+1] = edges[i+2];
+						edges[i+2] = e_temp;
+					}
+					else if ((i+3 < 4) && (FACE_getEdges(f)[k] == edges[i+3])){
+						e_temp = edges[i+1];
+						edges[i+1] = edges[i+3];
+						edges[i+3] = e_temp;
+					}
+				}
+			}
+		}
+
+		for (i = 0; i < 4; i++)
+			for (j = 0; j < 4; j++)
+				if (v->edges[j] == edges[i])
+					v->ring |= j << (2 * i);
+	}
+	else if (v->numEdges == 3) {
+		int is_e[3] = {0, 0, 0};
+		CCGFace *f5 = NULL;
+		int order[3];
+
+		for (j = 0; j < 3; j++) {
+			CCGEdge *e = v->edges[j];
+			if (e->numFaces == 2){
+				for (i =0; i < e->numFaces; i++){
+					if (e->faces[i]->numVerts == 5) {is_e[j] = 1; f5 = e->faces[i];}
+				}
+			}
+		}
+		// we check if only two edges are in 5-sided face
+		if (is_e[0] + is_e[1] + is_e[2] == 2) {
+			if (is_e[0] && is_e[1]) {
+				order[0] = 0; order[1] = 1; order[2] = 2;
+			}
+			if (is_e[0] && is_e[2]) {
+				order[0] = 0; order[1] = 2; order[2] = 1;
+			}
+			if (is_e[1] && is_e[2]) {
+				order[0] = 1; order[1] = 2; order[2] = 0;
+			}
+
+			// find the opposite vertex to align tangent of the dead-end spline
+			for (i = 0; i < 5; i++){
+				if (FACE_getVerts(f5)[i] == v) {
+					int corner = (i+2 > 4) ? i-3 : i+2;
+
+					for (j = 0; j < v->numFaces; j++) {
+						if (v->faces[j] == f5) {
+							v->ring = (order[0] | (order[1] << 2) | (order[2] << 4) | VertRing_eArc |
+							           (corner << VertRing_eCornerShift) | (j << VertRing_eFaceShift));
+							break;
+						}
+					}
+					break;
+				}
+			}
+		}
+	}
+}
+BLI_INLINE CCGEdge *_vert_getRingEdge(const CCGVert *v, int i)
+{
+	return v->edges[(v->ring >> (2 * i)) & 3];
+}
+BLI_INLINE CCGVert *_vert_getRingOpposite(const CCGVert *v)
+{
+	CCGFace *f5 = v->faces[v->ring >> VertRing_eFaceShift];
+	return FACE_getVerts(f5)[(v->ring >> VertRing_eCornerShift) & 7];
 }
 
 static int VERT_seam(const CCGVert *v)
@@ -657,13 +1142,17 @@ static int VERT_seam(const CCGVert *v)
 
 /***/
 
-static CCGEdge *_edge_new(CCGEdgeHDL eHDL, CCGVert *v0, CCGVert *v1, float crease, CCGSubSurf *ss)
+static int _edge_size(const CCGSubSurf *ss)
 {
 	int num_edge_data = ccg_edgebase(ss->subdivLevels + 1);
-	CCGEdge *e = CCGSUBSURF_alloc(ss,
-	                              sizeof(CCGEdge) +
-	                              ss->meshIFC.vertDataSize * num_edge_data +
-	                              ss->meshIFC.edgeUserSize);
+
+	return (sizeof(CCGEdge) +
+	        ss->meshIFC.vertDataSize * num_edge_data +
+	        ss->meshIFC.edgeUserSize);
+}
+/* the edge without adding it to its vertices, see ccgSubSurf__buildMesh */
+static CCGEdge *_edge_init(CCGEdge *e, CCGEdgeHDL eHDL, CCGVert *v0, CCGVert *v1, float crease, CCGSubSurf *ss)
+{
 	byte *userData;
 
 	e->eHDL = eHDL;
@@ -673,8 +1162,6 @@ static CCGEdge *_edge_new(CCGEdgeHDL eHDL, CCGVert *v0, CCGVert *v1, float creas
 	e->faces = NULL;
 	e->numFaces = 0;
 	e->flags = 0;
-	_vert_addEdge(v0, e, ss);
-	_vert_addEdge(v1, e, ss);
 
 	userData = ccgSubSurf_getEdgeUserData(ss, e);
 	memset(userData, 0, ss->meshIFC.edgeUserSize);
@@ -682,6 +1169,15 @@ static CCGEdge *_edge_new(CCGEdgeHDL eHDL, CCGVert *v0, CCGVert *v1, float creas
 
 	return e;
 }
+static CCGEdge *_edge_new(CCGEdgeHDL eHDL, CCGVert *v0, CCGVert *v1, float crease, CCGSubSurf *ss)
+{
+	CCGEdge *e = _edge_init(CCGSUBSURF_alloc(ss, _edge_size(ss)), eHDL, v0, v1, crease, ss);
+
+	_vert_addEdge(v0, e, ss);
+	_vert_addEdge(v1, e, ss);
+
+	return e;
+}
 static void _edge_remFace(CCGEdge *e, CCGFace *f)
 {
 	int i;
@@ -694,7 +1190,7 @@ static void _edge_remFace(CCGEdge *e, CCGFace *f)
 }
 static void _edge_addFace(CCGEdge *e, CCGFace *f, CCGSubSurf *ss)
 {
-	e->faces = CCGSUBSURF_realloc(ss, e->faces, (e->numFaces + 1) * sizeof(*e->faces), e->numFaces * sizeof(*e->faces));
+	e->faces = _adj_grow(ss, e->faces, e->numFaces);
 	e->faces[e->numFaces++] = f;
 }
 static int _edge_isBoundary(const CCGEdge *e)
@@ -735,8 +1231,8 @@ static void *_edge_getCoVert(CCGEdge *e, CCGVert *v, int lvl, int x, int dataSiz
 
 static void _edge_free(CCGEdge *e, CCGSubSurf *ss)
 {
-	CCGSUBSURF_free(ss, e->faces);
-	CCGSUBSURF_free(ss, e);
+	_adj_free(ss, e->faces);
+	_elem_free(ss, &ss->edgePool, e);
 }
 static void _edge_unlinkMarkAndFree(CCGEdge *e, CCGSubSurf *ss)
 {
@@ -759,17 +1255,22 @@ static float EDGE_getSharpness(CCGEdge *e, int lvl)
 		return e->crease - lvl;
 }
 
-static CCGFace *_face_new(CCGFaceHDL fHDL, CCGVert **verts, CCGEdge **edges, int numVerts, CCGSubSurf *ss)
+static int _face_size(const CCGSubSurf *ss, int numVerts)
 {
 	int maxGridSize = ccg_gridsize(ss->subdivLevels);
 	int num_face_data = (numVerts * maxGridSize +
-	                     numVerts * maxGridSize * maxGridSize + 1);
-	CCGFace *f = CCGSUBSURF_alloc(ss,
-	                              sizeof(CCGFace) +
-	                              sizeof(CCGVert *) * numVerts +
-	                              sizeof(CCGEdge *) * numVerts +
-	                              ss->meshIFC.vertDataSize * num_face_data +
-	                              ss->meshIFC.faceUserSize);
+	                     numVerts * maxGridSize * maxGridSize +
+	                     numVerts * ccg_gridbase(ss->subdivLevels) + 1);
+
+	return (sizeof(CCGFace) +
+	        sizeof(CCGVert *) * numVerts +
+	        sizeof(CCGEdge *) * numVerts +
+	        ss->meshIFC.vertDataSize * num_face_data +
+	        ss->meshIFC.faceUserSize);
+}
+/* the face without adding it to its vertices and edges */
+static CCGFace *_face_init(CCGFace *f, CCGFaceHDL fHDL, CCGVert **verts, CCGEdge **edges, int numVerts, CCGSubSurf *ss)
+{
 	byte *userData;
 	int i;
 
@@ -780,8 +1281,6 @@ static CCGFace *_face_new(CCGFaceHDL fHDL, CCGVert **verts, CCGEdge **edges, int
 	for (i = 0; i < numVerts; i++) {
 		FACE_getVerts(f)[i] = verts[i];
 		FACE_getEdges(f)[i] = edges[i];
-		_vert_addFace(verts[i], f, ss);
-		_edge_addFace(edges[i], f, ss);
 	}
 
 	userData = ccgSubSurf_getFaceUserData(ss, f);
@@ -790,34 +1289,61 @@ static CCGFace *_face_new(CCGFaceHDL fHDL, CCGVert **verts, CCGEdge **edges, int
 
 	return f;
 }
+static CCGFace *_face_new(CCGFaceHDL fHDL, CCGVert **verts, CCGEdge **edges, int numVerts, CCGSubSurf *ss)
+{
+	CCGFace *f = _face_init(CCGSUBSURF_alloc(ss, _face_size(ss, numVerts)), fHDL, verts, edges, numVerts, ss);
+	int i;
 
-BLI_INLINE void *_face_getIECo(CCGFace *f, int lvl, int S, int x, int levels, int dataSize)
+	for (i = 0; i < numVerts; i++) {
+		_vert_addFace(verts[i], f, ss);
+		_edge_addFace(edges[i], f, ss);
+	}
+
+	return f;
+}
+
+/* Each corner grid is its gridSize interior edge samples followed by the
+ * gridSize^2 interior face samples. The grids of the finest level come right
+ * after the center, the grids of the coarser levels are stored densely after
+ * those, level by level, so refining a coarse level does not walk the finest
+ * grid at a large stride. */
+BLI_INLINE byte *_face_getGridBase(CCGFace *f, int lvl, int S, int levels, int dataSize)
 {
 	int maxGridSize = ccg_gridsize(levels);
-	int spacing = ccg_spacing(levels, lvl);
-	byte *gridBase = FACE_getCenterData(f) + dataSize * (1 + S * (maxGridSize + maxGridSize * maxGridSize));
-	return &gridBase[dataSize * x * spacing];
+	int gridOffset;
+
+	if (lvl == levels) {
+		gridOffset = 1 + S * (maxGridSize + maxGridSize * maxGridSize);
+	}
+	else {
+		int gridSize = ccg_gridsize(lvl);
+		gridOffset = 1 + f->numVerts * (maxGridSize + maxGridSize * maxGridSize + ccg_gridbase(lvl)) +
+		             S * (gridSize + gridSize * gridSize);
+	}
+
+	return FACE_getCenterData(f) + dataSize * gridOffset;
+}
+BLI_INLINE void *_face_getIECo(CCGFace *f, int lvl, int S, int x, int levels, int dataSize)
+{
+	byte *gridBase = _face_getGridBase(f, lvl, S, levels, dataSize);
+	return &gridBase[dataSize * x];
 }
 BLI_INLINE void *_face_getIENo(CCGFace *f, int lvl, int S, int x, int levels, int dataSize, int normalDataOffset)
 {
-	int maxGridSize = ccg_gridsize(levels);
-	int spacing = ccg_spacing(levels, lvl);
-	byte *gridBase = FACE_getCenterData(f) + dataSize * (1 + S * (maxGridSize + maxGridSize * maxGridSize));
-	return &gridBase[dataSize * x * spacing + normalDataOffset];
+	byte *gridBase = _face_getGridBase(f, lvl, S, levels, dataSize);
+	return &gridBase[dataSize * x + normalDataOffset];
 }
 BLI_INLINE void *_face_getIFCo(CCGFace *f, int lvl, int S, int x, int y, int levels, int dataSize)
 {
-	int maxGridSize = ccg_gridsize(levels);
-	int spacing = ccg_spacing(levels, lvl);
-	byte *gridBase = FACE_getCenterData(f) + dataSize * (1 + S * (maxGridSize + maxGridSize * maxGridSize));
-	return &gridBase[dataSize * (maxGridSize + (y * maxGridSize + x) * spacing)];
+	int gridSize = ccg_gridsize(lvl);
+	byte *gridBase = _face_getGridBase(f, lvl, S, levels, dataSize);
+	return &gridBase[dataSize * (gridSize + y * gridSize + x)];
 }
 BLI_INLINE float *_face_getIFNo(CCGFace *f, int lvl, int S, int x, int y, int levels, int dataSize, int normalDataOffset)
 {
-	int maxGridSize = ccg_gridsize(levels);
-	int spacing = ccg_spacing(levels, lvl);
-	byte *gridBase = FACE_getCenterData(f) + dataSize * (1 + S * (maxGridSize + maxGridSize * maxGridSize));
-	return (float *) &gridBase[dataSize * (maxGridSize + (y * maxGridSize + x) * spacing) + normalDataOffset];
+	int gridSize = ccg_gridsize(lvl);
+	byte *gridBase = _face_getGridBase(f, lvl, S, levels, dataSize);
+	return (float *) &gridBase[dataSize * (gridSize + y * gridSize + x) + normalDataOffset];
 }
 BLI_INLINE int _face_getVertIndex(CCGFace *f, CCGVert *v)
 {
@@ -837,19 +1363,16 @@ BLI_INLINE int _face_getEdgeIndex(CCGFace *f, CCGEdge *e)
 }
 BLI_INLINE void *_face_getIFCoEdge(CCGFace *f, CCGEdge *e, int f_ed_idx, int lvl, int eX, int eY, int levels, int dataSize)
 {
-	int maxGridSize = ccg_gridsize(levels);
-	int spacing = ccg_spacing(levels, lvl);
+	int gridSize = ccg_gridsize(lvl);
 	int x, y, cx, cy;
 
 	BLI_assert(f_ed_idx == _face_getEdgeIndex(f, e));
 
-	eX = eX * spacing;
-	eY = eY * spacing;
 	if (e->v0 != FACE_getVerts(f)[f_ed_idx]) {
-		eX = (maxGridSize * 2 - 1) - 1 - eX;
+		eX = (gridSize * 2 - 1) - 1 - eX;
 	}
-	y = maxGridSize - 1 - eX;
-	x = maxGridSize - 1 - eY;
+	y = gridSize - 1 - eX;
+	x = gridSize - 1 - eY;
 	if (x < 0) {
 		f_ed_idx = (f_ed_idx + f->numVerts - 1) % f->numVerts;
 		cx = y;
@@ -864,7 +1387,7 @@ BLI_INLINE void *_face_getIFCoEdge(CCGFace *f, CCGEdge *e, int f_ed_idx, int lvl
 		cx = x;
 		cy = y;
 	}
-	return _face_getIFCo(f, levels, f_ed_idx, cx, cy, levels, dataSize);
+	return _face_getIFCo(f, lvl, f_ed_idx, cx, cy, levels, dataSize);
 }
 static float *_face_getIFNoEdge(CCGFace *f, CCGEdge *e, int f_ed_idx, int lvl, int eX, int eY, int levels, int dataSize, int normalDataOffset)
 {
@@ -888,7 +1411,7 @@ static void _face_calcIFNo(CCGFace *f, int lvl, int S, int x, int y, float no[3]
 
 static void _face_free(CCGFace *f, CCGSubSurf *ss)
 {
-	CCGSUBSURF_free(ss, f);
+	_elem_free(ss, &ss->facePool, f);
 }
 static void _face_unlinkMarkAndFree(CCGFace *f, CCGSubSurf *ss)
 {
@@ -919,9 +1442,9 @@ CCGSubSurf *ccgSubSurf_new(CCGMeshIFC *ifc, int subdivLevels, CCGAllocatorIFC *a
 		ss->allocatorIFC = *allocatorIFC;
 		ss->allocator = allocator;
 
-		ss->vMap = _ehash_new(0, &ss->allocatorIFC, ss->allocator);
-		ss->eMap = _ehash_new(0, &ss->allocatorIFC, ss->allocator);
-		ss->fMap = _ehash_new(0, &ss->allocatorIFC, ss->allocator);
+		ss->vMap = _ehash_new(0, ifc->denseHandles, &ss->allocatorIFC, ss->allocator);
+		ss->eMap = _ehash_new(0, ifc->denseHandles, &ss->allocatorIFC, ss->allocator);
+		ss->fMap = _ehash_new(0, ifc->denseHandles, &ss->allocatorIFC, ss->allocator);
 
 		ss->meshIFC = *ifc;
 		
@@ -939,9 +1462,6 @@ CCGSubSurf *ccgSubSurf_new(CCGMeshIFC *ifc, int subdivLevels, CCGAllocatorIFC *a
 
 		ss->allocMask = 0;
 
-		ss->q = CCGSUBSURF_alloc(ss, ss->meshIFC.vertDataSize);
-		ss->r = CCGSUBSURF_alloc(ss, ss->meshIFC.vertDataSize);
-
 		ss->currentAge = 0;
 
 		ss->syncState = eSyncState_None;
@@ -951,6 +1471,24 @@ CCGSubSurf *ccgSubSurf_new(CCGMeshIFC *ifc, int subdivLevels, CCGAllocatorIFC *a
 		ss->tempVerts = NULL;
 		ss->tempEdges = NULL;
 
+		ss->lazyNormals = 0;
+		ss->pendingNormals = 0;
+		ss->pendingV = NULL;
+		ss->pendingE = NULL;
+		ss->pendingF = NULL;
+		ss->numPendingV = ss->numPendingE = ss->numPendingF = 0;
+
+		ss->numThreads = 0;
+		ss->evalThreads = 0;
+
+		ss->adjacency = NULL;
+		ss->numAdjacency = 0;
+		ss->adjacencyLoose = 0;
+
+		memset(&ss->vertPool, 0, sizeof(ss->vertPool));
+		memset(&ss->edgePool, 0, sizeof(ss->edgePool));
+		memset(&ss->facePool, 0, sizeof(ss->facePool));
+
 		return ss;
 	}
 }
@@ -969,14 +1507,16 @@ void ccgSubSurf_free(CCGSubSurf *ss)
 		MEM_freeN(ss->tempEdges);
 	}
 
-	CCGSUBSURF_free(ss, ss->r);
-	CCGSUBSURF_free(ss, ss->q);
 	if (ss->defaultEdgeUserData) CCGSUBSURF_free(ss, ss->defaultEdgeUserData);
 
+	ccgSubSurf__dropPending(ss);
+
 	_ehash_free(ss->fMap, (EHEntryFreeFP) _face_free, ss);
 	_ehash_free(ss->eMap, (EHEntryFreeFP) _edge_free, ss);
 	_ehash_free(ss->vMap, (EHEntryFreeFP) _vert_free, ss);
 
+	if (ss->adjacency) MEM_freeN(ss->adjacency);
+
 	CCGSUBSURF_free(ss, ss);
 
 	if (allocatorIFC.release) {
@@ -1017,15 +1557,24 @@ CCGError ccgSubSurf_setSubdivisionLevels(CCGSubSurf *ss, int subdivisionLevels)
 	if (subdivisionLevels <= 0) {
 		return eCCGError_InvalidValue;
 	}
-	else if (subdivisionLevels != ss->subdivLevels) {
+	else if (subdivisionLevels == ss->subdivLevels) {
+		/* pass */
+	}
+	else if (ss->syncState == eSyncState_None) {
+		ccgSubSurf__changeLevels(ss, subdivisionLevels);
+	}
+	else {
 		ss->numGrids = 0;
 		ss->subdivLevels = subdivisionLevels;
+		ss->pendingNormals = 0;
+		ccgSubSurf__dropPending(ss);
 		_ehash_free(ss->vMap, (EHEntryFreeFP) _vert_free, ss);
 		_ehash_free(ss->eMap, (EHEntryFreeFP) _edge_free, ss);
 		_ehash_free(ss->fMap, (EHEntryFreeFP) _face_free, ss);
-		ss->vMap = _ehash_new(0, &ss->allocatorIFC, ss->allocator);
-		ss->eMap = _ehash_new(0, &ss->allocatorIFC, ss->allocator);
-		ss->fMap = _ehash_new(0, &ss->allocatorIFC, ss->allocator);
+		ccgSubSurf__freeAdjacency(ss);
+		ss->vMap = _ehash_new(0, ss->meshIFC.denseHandles, &ss->allocatorIFC, ss->allocator);
+		ss->eMap = _ehash_new(0, ss->meshIFC.denseHandles, &ss->allocatorIFC, ss->allocator);
+		ss->fMap = _ehash_new(0, ss->meshIFC.denseHandles, &ss->allocatorIFC, ss->allocator);
 	}
 
 	return eCCGError_None;
@@ -1094,6 +1643,38 @@ void ccgSubSurf_setNumLayers(CCGSubSurf *ss, int numLayers)
 	ss->meshIFC.numLayers = numLayers;
 }
 
+/* With lazyNormals the normals are left out of the syncs until
+ * ccgSubSurf_evalNormals asks for them, for callers that mostly read
+ * coordinates only. The other accessors can't tell coordinates and normals
+ * apart and don't calculate them. ccgSubSurf_evalNormals writes to the
+ * elements, readers on several threads need a lock around it. */
+void ccgSubSurf_setLazyNormals(CCGSubSurf *ss, int lazyNormals)
+{
+	ss->lazyNormals = lazyNormals;
+	if (!lazyNormals)
+		ccgSubSurf__needNormals(ss);
+}
+
+/* calculate the normals the syncs left out, does nothing when there are none */
+CCGError ccgSubSurf_evalNormals(CCGSubSurf *ss)
+{
+	if (ss->syncState != eSyncState_None) {
+		return eCCGError_InvalidSyncState;
+	}
+
+	ccgSubSurf__needNormals(ss);
+
+	return eCCGError_None;
+}
+
+/* Use at most numThreads threads in the passes of ss, 0 for as many as
+ * OpenMP has, see ccgSubSurf__numThreads. The result is the same with any
+ * count, so 1 gives a reference to check a run on more threads against. */
+void ccgSubSurf_setNumThreads(CCGSubSurf *ss, int numThreads)
+{
+	ss->numThreads = MAX2(numThreads, 0);
+}
+
 /***/
 
 CCGError ccgSubSurf_initFullSync(CCGSubSurf *ss)
@@ -1108,9 +1689,10 @@ CCGError ccgSubSurf_initFullSync(CCGSubSurf *ss)
 	ss->oldEMap = ss->eMap; 
 	ss->oldFMap = ss->fMap;
 
-	ss->vMap = _ehash_new(0, &ss->allocatorIFC, ss->allocator);
-	ss->eMap = _ehash_new(0, &ss->allocatorIFC, ss->allocator);
-	ss->fMap = _ehash_new(0, &ss->allocatorIFC, ss->allocator);
+	/* a full sync mostly resends the same mesh, size for the old maps */
+	ss->vMap = _ehash_new(ss->oldVMap->numEntries, ss->meshIFC.denseHandles, &ss->allocatorIFC, ss->allocator);
+	ss->eMap = _ehash_new(ss->oldEMap->numEntries, ss->meshIFC.denseHandles, &ss->allocatorIFC, ss->allocator);
+	ss->fMap = _ehash_new(ss->oldFMap->numEntries, ss->meshIFC.denseHandles, &ss->allocatorIFC, ss->allocator);
 
 	ss->numGrids = 0;
 
@@ -1142,14 +1724,15 @@ CCGError ccgSubSurf_syncVertDel(CCGSubSurf *ss, CCGVertHDL vHDL)
 		return eCCGError_InvalidSyncState;
 	}
 	else {
-		void **prevp;
-		CCGVert *v = _ehash_lookupWithPrev(ss->vMap, vHDL, &prevp);
+		EHSlot *slot;
+		CCGVert *v = _ehash_lookupWithSlot(ss->vMap, vHDL, &slot);
 
 		if (!v || v->numFaces || v->numEdges) {
 			return eCCGError_InvalidValue;
 		}
 		else {
-			*prevp = v->next;
+			ccgSubSurf__dropPending(ss);
+			_ehash_removeSlot(ss->vMap, slot);
 			_vert_free(v, ss);
 		}
 	}
@@ -1163,14 +1746,15 @@ CCGError ccgSubSurf_syncEdgeDel(CCGSubSurf *ss, CCGEdgeHDL eHDL)
 		return eCCGError_InvalidSyncState;
 	}
 	else {
-		void **prevp;
-		CCGEdge *e = _ehash_lookupWithPrev(ss->eMap, eHDL, &prevp);
+		EHSlot *slot;
+		CCGEdge *e = _ehash_lookupWithSlot(ss->eMap, eHDL, &slot);
 
 		if (!e || e->numFaces) {
 			return eCCGError_InvalidValue;
 		}
 		else {
-			*prevp = e->next;
+			ccgSubSurf__dropPending(ss);
+			_ehash_removeSlot(ss->eMap, slot);
 			_edge_unlinkMarkAndFree(e, ss);
 		}
 	}
@@ -1184,14 +1768,15 @@ CCGError ccgSubSurf_syncFaceDel(CCGSubSurf *ss, CCGFaceHDL fHDL)
 		return eCCGError_InvalidSyncState;
 	}
 	else {
-		void **prevp;
-		CCGFace *f = _ehash_lookupWithPrev(ss->fMap, fHDL, &prevp);
+		EHSlot *slot;
+		CCGFace *f = _ehash_lookupWithSlot(ss->fMap, fHDL, &slot);
 
 		if (!f) {
 			return eCCGError_InvalidValue;
 		}
 		else {
-			*prevp = f->next;
+			ccgSubSurf__dropPending(ss);
+			_ehash_removeSlot(ss->fMap, slot);
 			_face_unlinkMarkAndFree(f, ss);
 		}
 	}
@@ -1201,12 +1786,12 @@ CCGError ccgSubSurf_syncFaceDel(CCGSubSurf *ss, CCGFaceHDL fHDL)
 
 CCGError ccgSubSurf_syncVert(CCGSubSurf *ss, CCGVertHDL vHDL, const void *vertData, int seam, CCGVert **v_r)
 {
-	void **prevp;
+	EHSlot *slot;
 	CCGVert *v = NULL;
 	short seamflag = (seam) ? Vert_eSeam : 0;
 	
 	if (ss->syncState == eSyncState_Partial) {
-		v = _ehash_lookupWithPrev(ss->vMap, vHDL, &prevp);
+		v = _ehash_lookupWithSlot(ss->vMap, vHDL, &slot);
 		if (!v) {
 			v = _vert_new(vHDL, ss);
 			VertDataCopy(_vert_getCo(v, 0, ss->meshIFC.vertDataSize), vertData, ss);
@@ -1239,7 +1824,7 @@ CCGError ccgSubSurf_syncVert(CCGSubSurf *ss, CCGVertHDL vHDL, const void *vertDa
 			return eCCGError_InvalidSyncState;
 		}
 
-		v = _ehash_lookupWithPrev(ss->oldVMap, vHDL, &prevp);
+		v = _ehash_lookupWithSlot(ss->oldVMap, vHDL, &slot);
 		if (!v) {
 			v = _vert_new(vHDL, ss);
 			VertDataCopy(_vert_getCo(v, 0, ss->meshIFC.vertDataSize), vertData, ss);
@@ -1249,15 +1834,15 @@ CCGError ccgSubSurf_syncVert(CCGSubSurf *ss, CCGVertHDL vHDL, const void *vertDa
 		else if (!VertDataEqual(vertData, _vert_getCo(v, 0, ss->meshIFC.vertDataSize), ss) ||
 		         ((v->flags & Vert_eSeam) != seamflag))
 		{
-			*prevp = v->next;
+			_ehash_removeSlot(ss->oldVMap, slot);
 			_ehash_insert(ss->vMap, (EHEntry *) v);
 			VertDataCopy(_vert_getCo(v, 0, ss->meshIFC.vertDataSize), vertData, ss);
 			v->flags = Vert_eEffected | Vert_eChanged | seamflag;
 		}
 		else {
-			*prevp = v->next;
+			_ehash_removeSlot(ss->oldVMap, slot);
 			_ehash_insert(ss->vMap, (EHEntry *) v);
-			v->flags = 0;
+			v->flags = seamflag;
 		}
 	}
 
@@ -1267,11 +1852,11 @@ CCGError ccgSubSurf_syncVert(CCGSubSurf *ss, CCGVertHDL vHDL, const void *vertDa
 
 CCGError ccgSubSurf_syncEdge(CCGSubSurf *ss, CCGEdgeHDL eHDL, CCGVertHDL e_vHDL0, CCGVertHDL e_vHDL1, float crease, CCGEdge **e_r)
 {
-	void **prevp;
+	EHSlot *slot;
 	CCGEdge *e = NULL, *eNew;
 
 	if (ss->syncState == eSyncState_Partial) {
-		e = _ehash_lookupWithPrev(ss->eMap, eHDL, &prevp);
+		e = _ehash_lookupWithSlot(ss->eMap, eHDL, &slot);
 		if (!e || e->v0->vHDL != e_vHDL0 || e->v1->vHDL != e_vHDL1 || crease != e->crease) {
 			CCGVert *v0 = _ehash_lookup(ss->vMap, e_vHDL0);
 			CCGVert *v1 = _ehash_lookup(ss->vMap, e_vHDL1);
@@ -1279,9 +1864,10 @@ CCGError ccgSubSurf_syncEdge(CCGSubSurf *ss, CCGEdgeHDL eHDL, CCGVertHDL e_vHDL0
 			eNew = _edge_new(eHDL, v0, v1, crease, ss);
 
 			if (e) {
-				*prevp = eNew;
-				eNew->next = e->next;
+				slot->entry = (EHEntry *) eNew;
 
+				/* the pending arrays can't keep pointing at e */
+				ccgSubSurf__dropPending(ss);
 				_edge_unlinkMarkAndFree(e, ss);
 			}
 			else {
@@ -1300,7 +1886,7 @@ CCGError ccgSubSurf_syncEdge(CCGSubSurf *ss, CCGEdgeHDL eHDL, CCGVertHDL e_vHDL0
 			return eCCGError_InvalidSyncState;
 		}
 
-		e = _ehash_lookupWithPrev(ss->oldEMap, eHDL, &prevp);
+		e = _ehash_lookupWithSlot(ss->oldEMap, eHDL, &slot);
 		if (!e || e->v0->vHDL != e_vHDL0 || e->v1->vHDL != e_vHDL1 || e->crease != crease) {
 			CCGVert *v0 = _ehash_lookup(ss->vMap, e_vHDL0);
 			CCGVert *v1 = _ehash_lookup(ss->vMap, e_vHDL1);
@@ -1310,7 +1896,7 @@ CCGError ccgSubSurf_syncEdge(CCGSubSurf *ss, CCGEdgeHDL eHDL, CCGVertHDL e_vHDL0
 			e->v1->flags |= Vert_eEffected;
 		}
 		else {
-			*prevp = e->next;
+			_ehash_removeSlot(ss->oldEMap, slot);
 			_ehash_insert(ss->eMap, (EHEntry *) e);
 			e->flags = 0;
 			if ((e->v0->flags | e->v1->flags) & Vert_eChanged) {
@@ -1326,7 +1912,7 @@ CCGError ccgSubSurf_syncEdge(CCGSubSurf *ss, CCGEdgeHDL eHDL, CCGVertHDL e_vHDL0
 
 CCGError ccgSubSurf_syncFace(CCGSubSurf *ss, CCGFaceHDL fHDL, int numVerts, CCGVertHDL *vHDLs, CCGFace **f_r)
 {
-	void **prevp;
+	EHSlot *slot;
 	CCGFace *f = NULL, *fNew;
 	int j, k, topologyChanged = 0;
 
@@ -1337,7 +1923,7 @@ CCGError ccgSubSurf_syncFace(CCGSubSurf *ss, CCGFaceHDL fHDL, int numVerts, CCGV
 	}
 
 	if (ss->syncState == eSyncState_Partial) {
-		f = _ehash_lookupWithPrev(ss->fMap, fHDL, &prevp);
+		f = _ehash_lookupWithSlot(ss->fMap, fHDL, &slot);
 
 		for (k = 0; k < numVerts; k++) {
 			ss->tempVerts[k] = _ehash_lookup(ss->vMap, vHDLs[k]);
@@ -1361,9 +1947,10 @@ CCGError ccgSubSurf_syncFace(CCGSubSurf *ss, CCGFaceHDL fHDL, int numVerts, CCGV
 			if (f) {
 				ss->numGrids += numVerts - f->numVerts;
 
-				*prevp = fNew;
-				fNew->next = f->next;
+				slot->entry = (EHEntry *) fNew;
 
+				/* the pending arrays can't keep pointing at f */
+				ccgSubSurf__dropPending(ss);
 				_face_unlinkMarkAndFree(f, ss);
 			}
 			else {
@@ -1383,7 +1970,7 @@ CCGError ccgSubSurf_syncFace(CCGSubSurf *ss, CCGFaceHDL fHDL, int numVerts, CCGV
 			return eCCGError_InvalidSyncState;
 		}
 
-		f = _ehash_lookupWithPrev(ss->oldFMap, fHDL, &prevp);
+		f = _ehash_lookupWithSlot(ss->oldFMap, fHDL, &slot);
 
 		for (k = 0; k < numVerts; k++) {
 			ss->tempVerts[k] = _ehash_lookup(ss->vMap, vHDLs[k]);
@@ -1428,7 +2015,7 @@ CCGError ccgSubSurf_syncFace(CCGSubSurf *ss, CCGFaceHDL fHDL, int numVerts, CCGV
 				FACE_getVerts(f)[k]->flags |= Vert_eEffected;
 		}
 		else {
-			*prevp = f->next;
+			_ehash_removeSlot(ss->oldFMap, slot);
 			_ehash_insert(ss->fMap, (EHEntry *) f);
 			f->flags = 0;
 			ss->numGrids += f->numVerts;
@@ -1447,6 +2034,74 @@ CCGError ccgSubSurf_syncFace(CCGSubSurf *ss, CCGFaceHDL fHDL, int numVerts, CCGV
 	return eCCGError_None;
 }
 
+static void **_adj_pack(CCGSubSurf *ss, void **p, void **arr, int num)
+{
+	if (num)
+		memcpy(p, arr, num * sizeof(*p));
+	_adj_free(ss, arr);
+	return p + num;
+}
+
+/* Put the adjacency arrays back into one array after a sync that added
+ * elements, in map order and with the edges and faces of a vertex next to
+ * each other. The loose arrays of the sync calls are freed. */
+static void ccgSubSurf__packAdjacency(CCGSubSurf *ss)
+{
+	void **adjacency, **p;
+	int i, num = 0;
+
+	if (!ss->adjacencyLoose)
+		return;
+
+	for (i = 0; i < ss->vMap->numEntries; i++) {
+		CCGVert *v = (CCGVert *) ss->vMap->entries[i].entry;
+		num += v->numEdges + v->numFaces;
+	}
+	for (i = 0; i < ss->eMap->numEntries; i++) {
+		CCGEdge *e = (CCGEdge *) ss->eMap->entries[i].entry;
+		num += e->numFaces;
+	}
+
+	p = adjacency = MEM_mallocN(sizeof(*adjacency) * MAX2(num, 1), "CCGSubsurf adjacency");
+
+	for (i = 0; i < ss->vMap->numEntries; i++) {
+		CCGVert *v = (CCGVert *) ss->vMap->entries[i].entry;
+		void **edges = p, **faces;
+
+		faces = p = _adj_pack(ss, p, (void **) v->edges, v->numEdges);
+		p = _adj_pack(ss, p, (void **) v->faces, v->numFaces);
+		v->edges = (v->numEdges) ? (CCGEdge **) edges : NULL;
+		v->faces = (v->numFaces) ? (CCGFace **) faces : NULL;
+	}
+	for (i = 0; i < ss->eMap->numEntries; i++) {
+		CCGEdge *e = (CCGEdge *) ss->eMap->entries[i].entry;
+		void **faces = p;
+
+		p = _adj_pack(ss, p, (void **) e->faces, e->numFaces);
+		e->faces = (e->numFaces) ? (CCGFace **) faces : NULL;
+	}
+
+	if (ss->adjacency)
+		MEM_freeN(ss->adjacency);
+	ss->adjacency = adjacency;
+	ss->numAdjacency = num;
+	ss->adjacencyLoose = 0;
+}
+
+/* update the cached one rings of the vertices the sync changed the topology
+ * around, full and partial syncs can both add and remove elements */
+static void ccgSubSurf__calcRings(CCGSubSurf *ss)
+{
+	int i;
+
+	for (i = 0; i < ss->vMap->numEntries; i++) {
+		CCGVert *v = (CCGVert *) ss->vMap->entries[i].entry;
+
+		if (v->ring == VertRing_eDirty)
+			_vert_calcRing(v);
+	}
+}
+
 CCGError ccgSubSurf_processSync(CCGSubSurf *ss)
 {
 	if (ss->syncState == eSyncState_Partial) {
@@ -1455,6 +2110,7 @@ CCGError ccgSubSurf_processSync(CCGSubSurf *ss)
 		ccgSubSurf__sync(ss);
 	}
 	else if (ss->syncState) {
+		ccgSubSurf__dropPending(ss);
 		_ehash_free(ss->oldFMap, (EHEntryFreeFP) _face_unlinkMarkAndFree, ss);
 		_ehash_free(ss->oldEMap, (EHEntryFreeFP) _edge_unlinkMarkAndFree, ss);
 		_ehash_free(ss->oldVMap, (EHEntryFreeFP) _vert_free, ss);
@@ -1478,258 +2134,787 @@ CCGError ccgSubSurf_processSync(CCGSubSurf *ss)
 	return eCCGError_None;
 }
 
-#define VERT_getCo(v, lvl)                  _vert_getCo(v, lvl, vertDataSize)
-#define VERT_getNo(e, lvl)                  _vert_getNo(v, lvl, vertDataSize, normalDataOffset)
-#define EDGE_getCo(e, lvl, x)               _edge_getCo(e, lvl, x, vertDataSize)
-#define EDGE_getNo(e, lvl, x)               _edge_getNo(e, lvl, x, vertDataSize, normalDataOffset)
-#define FACE_getIFNo(f, lvl, S, x, y)       _face_getIFNo(f, lvl, S, x, y, subdivLevels, vertDataSize, normalDataOffset)
-#define FACE_calcIFNo(f, lvl, S, x, y, no)  _face_calcIFNo(f, lvl, S, x, y, no, subdivLevels, vertDataSize)
-#define FACE_getIENo(f, lvl, S, x)          _face_getIENo(f, lvl, S, x, subdivLevels, vertDataSize, normalDataOffset)
-
-static void ccgSubSurf__calcVertNormals(CCGSubSurf *ss,
-                                        CCGVert **effectedV, CCGEdge **effectedE, CCGFace **effectedF,
-                                        int numEffectedV, int numEffectedE, int numEffectedF)
+/* Move the vertices of an already synced mesh, for when only the coordinates
+ * changed since the last sync. Goes straight to the subdivision without the
+ * hash lookups and topology checks of a full sync, the result is the same.
+ * vertCos is indexed by the vertex handles, which have to be indices as
+ * used by subsurf_ccg, and only fits vertex data of 3 layers. */
+CCGError ccgSubSurf_updatePositions(CCGSubSurf *ss, const float (*vertCos)[3], int numVerts)
 {
-	int i, ptrIdx;
-	int subdivLevels = ss->subdivLevels;
-	int lvl = ss->subdivLevels;
-	int edgeSize = ccg_edgesize(lvl);
-	int gridSize = ccg_gridsize(lvl);
-	int normalDataOffset = ss->normalDataOffset;
-	int vertDataSize = ss->meshIFC.vertDataSize;
+	int i;
 
-#pragma omp parallel for private(ptrIdx) if (numEffectedF * edgeSize * edgeSize * 4 >= CCG_OMP_LIMIT)
-	for (ptrIdx = 0; ptrIdx < numEffectedF; ptrIdx++) {
-		CCGFace *f = (CCGFace *) effectedF[ptrIdx];
-		int S, x, y;
-		float no[3];
+	if (ss->syncState != eSyncState_None) {
+		return eCCGError_InvalidSyncState;
+	}
+	else if (numVerts != ss->vMap->numEntries || ss->meshIFC.numLayers != 3) {
+		return eCCGError_InvalidValue;
+	}
 
-		for (S = 0; S < f->numVerts; S++) {
-			for (y = 0; y < gridSize - 1; y++) {
-				for (x = 0; x < gridSize - 1; x++) {
-					NormZero(FACE_getIFNo(f, lvl, S, x, y));
-				}
-			}
+	/* check every handle before anything moves */
+	for (i = 0; i < ss->vMap->numEntries; i++) {
+		CCGVert *v = (CCGVert *) ss->vMap->entries[i].entry;
+		intptr_t index = (intptr_t) v->vHDL;
 
-			if (FACE_getEdges(f)[(S - 1 + f->numVerts) % f->numVerts]->flags & Edge_eEffected) {
-				for (x = 0; x < gridSize - 1; x++) {
-					NormZero(FACE_getIFNo(f, lvl, S, x, gridSize - 1));
-				}
-			}
-			if (FACE_getEdges(f)[S]->flags & Edge_eEffected) {
-				for (y = 0; y < gridSize - 1; y++) {
-					NormZero(FACE_getIFNo(f, lvl, S, gridSize - 1, y));
-				}
+		if (index < 0 || index >= numVerts)
+			return eCCGError_InvalidValue;
+	}
+
+	ss->currentAge++;
+
+	for (i = 0; i < ss->vMap->numEntries; i++) {
+		CCGVert *v = (CCGVert *) ss->vMap->entries[i].entry;
+		const float *vertCo = vertCos[GET_INT_FROM_POINTER(v->vHDL)];
+		float *co = _vert_getCo(v, 0, ss->meshIFC.vertDataSize);
+
+		if (co[0] != vertCo[0] || co[1] != vertCo[1] || co[2] != vertCo[2]) {
+			int j, k;
+
+			co[0] = vertCo[0];
+			co[1] = vertCo[1];
+			co[2] = vertCo[2];
+			v->flags |= Vert_eEffected;
+
+			/* same as syncEdge and syncFace do for changed vertices */
+			for (j = 0; j < v->numEdges; j++) {
+				CCGEdge *e = v->edges[j];
+				e->v0->flags |= Vert_eEffected;
+				e->v1->flags |= Vert_eEffected;
 			}
-			if (FACE_getVerts(f)[S]->flags & Vert_eEffected) {
-				NormZero(FACE_getIFNo(f, lvl, S, gridSize - 1, gridSize - 1));
+			for (j = 0; j < v->numFaces; j++) {
+				CCGFace *f = v->faces[j];
+				for (k = 0; k < f->numVerts; k++)
+					FACE_getVerts(f)[k]->flags |= Vert_eEffected;
 			}
 		}
+	}
 
-		for (S = 0; S < f->numVerts; S++) {
-			int yLimit = !(FACE_getEdges(f)[(S - 1 + f->numVerts) % f->numVerts]->flags & Edge_eEffected);
-			int xLimit = !(FACE_getEdges(f)[S]->flags & Edge_eEffected);
-			int yLimitNext = xLimit;
-			int xLimitPrev = yLimit;
-			
-			for (y = 0; y < gridSize - 1; y++) {
-				for (x = 0; x < gridSize - 1; x++) {
-					int xPlusOk = (!xLimit || x < gridSize - 2);
-					int yPlusOk = (!yLimit || y < gridSize - 2);
-
-					FACE_calcIFNo(f, lvl, S, x, y, no);
-
-					NormAdd(FACE_getIFNo(f, lvl, S, x + 0, y + 0), no);
-					if (xPlusOk)
-						NormAdd(FACE_getIFNo(f, lvl, S, x + 1, y + 0), no);
-					if (yPlusOk)
-						NormAdd(FACE_getIFNo(f, lvl, S, x + 0, y + 1), no);
-					if (xPlusOk && yPlusOk) {
-						if (x < gridSize - 2 || y < gridSize - 2 || FACE_getVerts(f)[S]->flags & Vert_eEffected) {
-							NormAdd(FACE_getIFNo(f, lvl, S, x + 1, y + 1), no);
-						}
-					}
+	ccgSubSurf__sync(ss);
 
-					if (x == 0 && y == 0) {
-						int K;
+	return eCCGError_None;
+}
 
-						if (!yLimitNext || 1 < gridSize - 1)
-							NormAdd(FACE_getIFNo(f, lvl, (S + 1) % f->numVerts, 0, 1), no);
-						if (!xLimitPrev || 1 < gridSize - 1)
-							NormAdd(FACE_getIFNo(f, lvl, (S - 1 + f->numVerts) % f->numVerts, 1, 0), no);
+/* whether the arrays describe the topology of the last sync, with the
+ * indices as handles */
+static int ccgSubSurf__isSyncedMesh(CCGSubSurf *ss, int numVerts,
+                                    const int (*edgeVerts)[2], int numEdges,
+                                    const int *faceOffsets, const int *faceVerts, int numFaces)
+{
+#ifdef _OPENMP
+	int numThreads = ccgSubSurf__numThreads(ss, faceOffsets[numFaces]);
+#endif
+	int i, same = 1;
 
-						for (K = 0; K < f->numVerts; K++) {
-							if (K != S) {
-								NormAdd(FACE_getIFNo(f, lvl, K, 0, 0), no);
-							}
-						}
-					}
-					else if (y == 0) {
-						NormAdd(FACE_getIFNo(f, lvl, (S + 1) % f->numVerts, 0, x), no);
-						if (!yLimitNext || x < gridSize - 2)
-							NormAdd(FACE_getIFNo(f, lvl, (S + 1) % f->numVerts, 0, x + 1), no);
-					}
-					else if (x == 0) {
-						NormAdd(FACE_getIFNo(f, lvl, (S - 1 + f->numVerts) % f->numVerts, y, 0), no);
-						if (!xLimitPrev || y < gridSize - 2)
-							NormAdd(FACE_getIFNo(f, lvl, (S - 1 + f->numVerts) % f->numVerts, y + 1, 0), no);
-					}
-				}
+	if (numVerts != ss->vMap->numEntries ||
+	    numEdges != ss->eMap->numEntries ||
+	    numFaces != ss->fMap->numEntries)
+	{
+		return 0;
+	}
+
+	/* with the counts equal finding every index is enough for the verts */
+	for (i = 0; i < numVerts && same; i++) {
+		if (!_ehash_lookup(ss->vMap, SET_INT_IN_POINTER(i)))
+			same = 0;
+	}
+
+	for (i = 0; i < numEdges && same; i++) {
+		CCGEdge *e = _ehash_lookup(ss->eMap, SET_INT_IN_POINTER(i));
+
+		if (!e ||
+		    e->v0->vHDL != SET_INT_IN_POINTER(edgeVerts[i][0]) ||
+		    e->v1->vHDL != SET_INT_IN_POINTER(edgeVerts[i][1]))
+		{
+			same = 0;
+		}
+	}
+
+	if (!same)
+		return 0;
+
+#pragma omp parallel for private(i) reduction(&&: same) num_threads(numThreads) if (numThreads > 1) schedule(guided)
+	for (i = 0; i < numFaces; i++) {
+		CCGFace *f = _ehash_lookup(ss->fMap, SET_INT_IN_POINTER(i));
+		const int *fv = &faceVerts[faceOffsets[i]];
+		int S, numFaceVerts = faceOffsets[i + 1] - faceOffsets[i];
+
+		if (!f || f->numVerts != numFaceVerts) {
+			same = 0;
+		}
+		else {
+			for (S = 0; S < numFaceVerts; S++) {
+				if (FACE_getVerts(f)[S]->vHDL != SET_INT_IN_POINTER(fv[S]))
+					same = 0;
 			}
 		}
 	}
-	/* XXX can I reduce the number of normalisations here? */
-	for (ptrIdx = 0; ptrIdx < numEffectedV; ptrIdx++) {
-		CCGVert *v = (CCGVert *) effectedV[ptrIdx];
-		float *no = VERT_getNo(v, lvl);
 
-		NormZero(no);
+	return same;
+}
+
+/* the full sync of an unchanged topology, flags the vertices the same way
+ * syncVert, syncEdge and syncFace do */
+static void ccgSubSurf__updateMesh(CCGSubSurf *ss,
+                                   const void *vertData, int vertStride, int numVerts,
+                                   const float *edgeCreases, int numEdges, int numFaces)
+{
+#ifdef _OPENMP
+	int numThreads = ccgSubSurf__numThreads(ss, numVerts);
+#endif
+	int i, j, k;
+
+#pragma omp parallel for private(i) num_threads(numThreads) if (numThreads > 1) schedule(guided)
+	for (i = 0; i < numVerts; i++) {
+		CCGVert *v = _ehash_lookup(ss->vMap, SET_INT_IN_POINTER(i));
+		const float *data = (const float *) ((const byte *) vertData + (size_t) i * vertStride);
 
-		for (i = 0; i < v->numFaces; i++) {
-			CCGFace *f = v->faces[i];
-			NormAdd(no, FACE_getIFNo(f, lvl, _face_getVertIndex(f, v), gridSize - 1, gridSize - 1));
+		if (!VertDataEqual(data, _vert_getCo(v, 0, ss->meshIFC.vertDataSize), ss) || (v->flags & Vert_eSeam)) {
+			VertDataCopy(_vert_getCo(v, 0, ss->meshIFC.vertDataSize), data, ss);
+			v->flags = Vert_eEffected | Vert_eChanged;
+		}
+		else {
+			v->flags = 0;
 		}
+	}
+
+	for (i = 0; i < numEdges; i++) {
+		CCGEdge *e = _ehash_lookup(ss->eMap, SET_INT_IN_POINTER(i));
 
-		if (UNLIKELY(v->numFaces == 0)) {
-			NormCopy(no, VERT_getCo(v, lvl));
+		e->flags = 0;
+		if (edgeCreases[i] != e->crease) {
+			/* syncEdge makes a new edge, the crease only matters for the
+			 * subdivision so change it in place */
+			e->crease = edgeCreases[i];
+			e->v0->flags |= Vert_eEffected;
+			e->v1->flags |= Vert_eEffected;
+		}
+		if ((e->v0->flags | e->v1->flags) & Vert_eChanged) {
+			e->v0->flags |= Vert_eEffected;
+			e->v1->flags |= Vert_eEffected;
 		}
+	}
 
-		Normalize(no);
+	for (i = 0; i < numFaces; i++) {
+		CCGFace *f = _ehash_lookup(ss->fMap, SET_INT_IN_POINTER(i));
 
-		for (i = 0; i < v->numFaces; i++) {
-			CCGFace *f = v->faces[i];
-			NormCopy(FACE_getIFNo(f, lvl, _face_getVertIndex(f, v), gridSize - 1, gridSize - 1), no);
+		f->flags = 0;
+		for (j = 0; j < f->numVerts; j++) {
+			if (FACE_getVerts(f)[j]->flags & Vert_eChanged) {
+				for (k = 0; k < f->numVerts; k++)
+					FACE_getVerts(f)[k]->flags |= Vert_eEffected;
+				break;
+			}
 		}
 	}
-	for (ptrIdx = 0; ptrIdx < numEffectedE; ptrIdx++) {
-		CCGEdge *e = (CCGEdge *) effectedE[ptrIdx];
+}
 
-		if (e->numFaces) {
-			CCGFace *fLast = e->faces[e->numFaces - 1];
-			int x;
+/* finds the edge of every face side, vertEdgeStart/vertEdges list the edges
+ * of each vertex. Returns 0 when a side has no edge. */
+static int ccgSubSurf__matchFaceEdges(const int (*edgeVerts)[2], const int *vertEdgeStart, const int *vertEdges,
+                                      const int *faceOffsets, const int *faceVerts, int numFaces,
+                                      int *loopEdges)
+{
+#ifdef _OPENMP
+	int numThreads = ccgSubSurf__numThreads(NULL, faceOffsets[numFaces]);
+#endif
+	int i, found = 1;
 
-			for (i = 0; i < e->numFaces - 1; i++) {
-				CCGFace *f = e->faces[i];
-				const int f_ed_idx = _face_getEdgeIndex(f, e);
-				const int f_ed_idx_last = _face_getEdgeIndex(fLast, e);
+#pragma omp parallel for private(i) reduction(&&: found) num_threads(numThreads) if (numThreads > 1) schedule(guided)
+	for (i = 0; i < numFaces; i++) {
+		int S, numFaceVerts = faceOffsets[i + 1] - faceOffsets[i];
 
-				for (x = 1; x < edgeSize - 1; x++) {
-					NormAdd(_face_getIFNoEdge(fLast, e, f_ed_idx_last, lvl, x, 0, subdivLevels, vertDataSize, normalDataOffset),
-					        _face_getIFNoEdge(f, e, f_ed_idx, lvl, x, 0, subdivLevels, vertDataSize, normalDataOffset));
-				}
-			}
+		for (S = 0; S < numFaceVerts; S++) {
+			int l = faceOffsets[i] + S;
+			int a = faceVerts[l], b = faceVerts[faceOffsets[i] + (S + 1) % numFaceVerts];
+			int k;
 
-			for (i = 0; i < e->numFaces - 1; i++) {
-				CCGFace *f = e->faces[i];
-				const int f_ed_idx = _face_getEdgeIndex(f, e);
-				const int f_ed_idx_last = _face_getEdgeIndex(fLast, e);
+			/* last edge first, same as _vert_findEdgeTo */
+			loopEdges[l] = -1;
+			for (k = vertEdgeStart[a + 1] - 1; k >= vertEdgeStart[a]; k--) {
+				const int *ev = edgeVerts[vertEdges[k]];
 
-				for (x = 1; x < edgeSize - 1; x++) {
-					NormCopy(_face_getIFNoEdge(f, e, f_ed_idx, lvl, x, 0, subdivLevels, vertDataSize, normalDataOffset),
-					         _face_getIFNoEdge(fLast, e, f_ed_idx_last, lvl, x, 0, subdivLevels, vertDataSize, normalDataOffset));
+				if ((ev[0] == a && ev[1] == b) || (ev[0] == b && ev[1] == a)) {
+					loopEdges[l] = vertEdges[k];
+					break;
 				}
 			}
+
+			if (loopEdges[l] == -1)
+				found = 0;
 		}
 	}
 
-#pragma omp parallel for private(ptrIdx) if (numEffectedF * edgeSize * edgeSize * 4 >= CCG_OMP_LIMIT)
-	for (ptrIdx = 0; ptrIdx < numEffectedF; ptrIdx++) {
-		CCGFace *f = (CCGFace *) effectedF[ptrIdx];
-		int S, x, y;
+	return found;
+}
 
-		for (S = 0; S < f->numVerts; S++) {
-			NormCopy(FACE_getIFNo(f, lvl, (S + 1) % f->numVerts, 0, gridSize - 1),
-			         FACE_getIFNo(f, lvl, S, gridSize - 1, 0));
+/* checks the indices of the arrays and finds the edge of every face side,
+ * returns 0 when one is out of range or a side has no edge. vertEdgeStart
+ * and vertEdges get the edges of each vertex in edge order, loopEdges the
+ * edge from each face corner to the next one */
+static int ccgSubSurf__matchMesh(int numVerts, const int (*edgeVerts)[2], int numEdges,
+                                 const int *faceOffsets, const int *faceVerts, int numFaces,
+                                 int **vertEdgeStart_r, int **vertEdges_r, int **loopEdges_r)
+{
+	int numLoops = faceOffsets[numFaces];
+	int *vertEdgeStart, *vertEdges, *loopEdges;
+	int i;
+
+	for (i = 0; i < numEdges; i++) {
+		if (edgeVerts[i][0] < 0 || edgeVerts[i][0] >= numVerts ||
+		    edgeVerts[i][1] < 0 || edgeVerts[i][1] >= numVerts ||
+		    edgeVerts[i][0] == edgeVerts[i][1])
+		{
+			return 0;
 		}
+	}
+	for (i = 0; i < numLoops; i++) {
+		if (faceVerts[i] < 0 || faceVerts[i] >= numVerts)
+			return 0;
+	}
 
-		for (S = 0; S < f->numVerts; S++) {
-			for (y = 0; y < gridSize; y++) {
-				for (x = 0; x < gridSize; x++) {
-					float *no = FACE_getIFNo(f, lvl, S, x, y);
-					Normalize(no);
-				}
-			}
+	/* edges of each vertex in edge order, a counting sort */
+	vertEdgeStart = MEM_callocN(sizeof(*vertEdgeStart) * (numVerts + 1), "CCGSubsurf vertEdgeStart");
+	vertEdges = MEM_mallocN(sizeof(*vertEdges) * MAX2(numEdges * 2, 1), "CCGSubsurf vertEdges");
+	for (i = 0; i < numEdges; i++) {
+		vertEdgeStart[edgeVerts[i][0] + 1]++;
+		vertEdgeStart[edgeVerts[i][1] + 1]++;
+	}
+	for (i = 0; i < numVerts; i++)
+		vertEdgeStart[i + 1] += vertEdgeStart[i];
+	for (i = 0; i < numEdges; i++) {
+		vertEdges[vertEdgeStart[edgeVerts[i][0]]++] = i;
+		vertEdges[vertEdgeStart[edgeVerts[i][1]]++] = i;
+	}
+	for (i = numVerts; i > 0; i--)
+		vertEdgeStart[i] = vertEdgeStart[i - 1];
+	vertEdgeStart[0] = 0;
+
+	loopEdges = MEM_mallocN(sizeof(*loopEdges) * MAX2(numLoops, 1), "CCGSubsurf loopEdges");
+	if (!ccgSubSurf__matchFaceEdges(edgeVerts, vertEdgeStart, vertEdges, faceOffsets, faceVerts, numFaces, loopEdges)) {
+		MEM_freeN(loopEdges);
+		MEM_freeN(vertEdges);
+		MEM_freeN(vertEdgeStart);
+		return 0;
+	}
 
-			VertDataCopy((float *)((byte *)FACE_getCenterData(f) + normalDataOffset),
-			             FACE_getIFNo(f, lvl, S, 0, 0), ss);
+	*vertEdgeStart_r = vertEdgeStart;
+	*vertEdges_r = vertEdges;
+	*loopEdges_r = loopEdges;
+	return 1;
+}
 
-			for (x = 1; x < gridSize - 1; x++)
-				NormCopy(FACE_getIENo(f, lvl, S, x),
-				         FACE_getIFNo(f, lvl, S, x, 0));
-		}
+/* replaces all elements, the elements go in one pool per type and the
+ * adjacency is laid out in ss->adjacency up front from the counts, as
+ * ccgSubSurf__packAdjacency would */
+static void ccgSubSurf__buildMesh(CCGSubSurf *ss,
+                                  const void *vertData, int vertStride, int numVerts,
+                                  const int (*edgeVerts)[2], const float *edgeCreases, int numEdges,
+                                  const int *faceOffsets, const int *faceVerts, int numFaces,
+                                  const int *vertEdgeStart, const int *loopEdges)
+{
+	int numLoops = faceOffsets[numFaces];
+	int *vertNumFaces, *edgeNumFaces;
+	CCGVert **verts, **fVerts;
+	CCGEdge **edges, **fEdges;
+	void **p;
+	byte *vertMem, *edgeMem, *faceMem;
+	size_t vertStep = _elem_alignSize(_vert_size(ss)), edgeStep = _elem_alignSize(_edge_size(ss));
+	size_t faceBytes = 0;
+	int i, maxFaceVerts = 0;
+
+	vertNumFaces = MEM_callocN(sizeof(*vertNumFaces) * MAX2(numVerts, 1), "CCGSubsurf vertNumFaces");
+	edgeNumFaces = MEM_callocN(sizeof(*edgeNumFaces) * MAX2(numEdges, 1), "CCGSubsurf edgeNumFaces");
+	for (i = 0; i < numLoops; i++) {
+		vertNumFaces[faceVerts[i]]++;
+		edgeNumFaces[loopEdges[i]]++;
+	}
+	for (i = 0; i < numFaces; i++) {
+		maxFaceVerts = MAX2(maxFaceVerts, faceOffsets[i + 1] - faceOffsets[i]);
+		faceBytes += _elem_alignSize(_face_size(ss, faceOffsets[i + 1] - faceOffsets[i]));
 	}
 
-	for (ptrIdx = 0; ptrIdx < numEffectedE; ptrIdx++) {
-		CCGEdge *e = (CCGEdge *) effectedE[ptrIdx];
+	/* nothing of the old mesh is kept */
+	_ehash_free(ss->fMap, (EHEntryFreeFP) _face_free, ss);
+	_ehash_free(ss->eMap, (EHEntryFreeFP) _edge_free, ss);
+	_ehash_free(ss->vMap, (EHEntryFreeFP) _vert_free, ss);
+	ccgSubSurf__freeAdjacency(ss);
+	ss->vMap = _ehash_new(numVerts, ss->meshIFC.denseHandles, &ss->allocatorIFC, ss->allocator);
+	ss->eMap = _ehash_new(numEdges, ss->meshIFC.denseHandles, &ss->allocatorIFC, ss->allocator);
+	ss->fMap = _ehash_new(numFaces, ss->meshIFC.denseHandles, &ss->allocatorIFC, ss->allocator);
 
-		if (e->numFaces) {
-			CCGFace *f = e->faces[0];
-			int x;
-			const int f_ed_idx = _face_getEdgeIndex(f, e);
+	verts = MEM_mallocN(sizeof(*verts) * MAX2(numVerts, 1), "CCGSubsurf verts");
+	edges = MEM_mallocN(sizeof(*edges) * MAX2(numEdges, 1), "CCGSubsurf edges");
+	fVerts = MEM_mallocN(sizeof(*fVerts) * MAX2(maxFaceVerts, 1), "CCGSubsurf fVerts");
+	fEdges = MEM_mallocN(sizeof(*fEdges) * MAX2(maxFaceVerts, 1), "CCGSubsurf fEdges");
 
-			for (x = 0; x < edgeSize; x++)
-				NormCopy(EDGE_getNo(e, lvl, x),
-				         _face_getIFNoEdge(f, e, f_ed_idx, lvl, x, 0, subdivLevels, vertDataSize, normalDataOffset));
+	ss->numAdjacency = numEdges * 2 + numLoops * 2;
+	p = ss->adjacency = MEM_mallocN(sizeof(*ss->adjacency) * MAX2(ss->numAdjacency, 1), "CCGSubsurf adjacency");
+
+	/* the old elements are all freed, so are their pools */
+	vertMem = _elem_allocPool(&ss->vertPool, vertStep * numVerts, numVerts);
+	edgeMem = _elem_allocPool(&ss->edgePool, edgeStep * numEdges, numEdges);
+	faceMem = _elem_allocPool(&ss->facePool, faceBytes, numFaces);
+
+	for (i = 0; i < numVerts; i++) {
+		CCGVert *v = verts[i] = _vert_init((CCGVert *) (vertMem + vertStep * i), SET_INT_IN_POINTER(i), ss);
+		int numVertEdges = vertEdgeStart[i + 1] - vertEdgeStart[i];
+
+		VertDataCopy(_vert_getCo(v, 0, ss->meshIFC.vertDataSize),
+		             (const float *) ((const byte *) vertData + (size_t) i * vertStride), ss);
+		v->flags = Vert_eEffected;
+		if (numVertEdges)
+			v->edges = (CCGEdge **) p;
+		p += numVertEdges;
+		if (vertNumFaces[i])
+			v->faces = (CCGFace **) p;
+		p += vertNumFaces[i];
+
+		_ehash_insert(ss->vMap, (EHEntry *) v);
+	}
+
+	for (i = 0; i < numEdges; i++) {
+		CCGVert *v0 = verts[edgeVerts[i][0]], *v1 = verts[edgeVerts[i][1]];
+		CCGEdge *e = edges[i] = _edge_init((CCGEdge *) (edgeMem + edgeStep * i),
+		                                   SET_INT_IN_POINTER(i), v0, v1, edgeCreases[i], ss);
+
+		v0->edges[v0->numEdges++] = e;
+		v1->edges[v1->numEdges++] = e;
+		if (edgeNumFaces[i])
+			e->faces = (CCGFace **) p;
+		p += edgeNumFaces[i];
+
+		_ehash_insert(ss->eMap, (EHEntry *) e);
+	}
+
+	for (i = 0; i < numFaces; i++) {
+		int S, numFaceVerts = faceOffsets[i + 1] - faceOffsets[i];
+		CCGFace *f;
+
+		for (S = 0; S < numFaceVerts; S++) {
+			fVerts[S] = verts[faceVerts[faceOffsets[i] + S]];
+			fEdges[S] = edges[loopEdges[faceOffsets[i] + S]];
 		}
-		else {
-			/* set to zero here otherwise the normals are uninitialized memory
-			 * render: tests/animation/knight.blend with valgrind.
-			 * we could be more clever and interpolate vertex normals but these are
-			 * most likely not used so just zero out. */
-			int x;
-
-			for (x = 0; x < edgeSize; x++) {
-				float *no = EDGE_getNo(e, lvl, x);
-				NormCopy(no, EDGE_getCo(e, lvl, x));
-				Normalize(no);
-			}
+
+		f = _face_init((CCGFace *) faceMem, SET_INT_IN_POINTER(i), fVerts, fEdges, numFaceVerts, ss);
+		faceMem += _elem_alignSize(_face_size(ss, numFaceVerts));
+		for (S = 0; S < numFaceVerts; S++) {
+			fVerts[S]->faces[fVerts[S]->numFaces++] = f;
+			fEdges[S]->faces[fEdges[S]->numFaces++] = f;
 		}
+
+		_ehash_insert(ss->fMap, (EHEntry *) f);
 	}
-}
-#undef FACE_getIFNo
 
-#define FACE_getIECo(f, lvl, S, x)      _face_getIECo(f, lvl, S, x, subdivLevels, vertDataSize)
-#define FACE_getIFCo(f, lvl, S, x, y)   _face_getIFCo(f, lvl, S, x, y, subdivLevels, vertDataSize)
+	ss->numGrids = numLoops;
 
-static void ccgSubSurf__calcSubdivLevel(CCGSubSurf *ss,
-                                        CCGVert **effectedV, CCGEdge **effectedE, CCGFace **effectedF,
-                                        int numEffectedV, int numEffectedE, int numEffectedF, int curLvl)
+	MEM_freeN(fEdges);
+	MEM_freeN(fVerts);
+	MEM_freeN(edges);
+	MEM_freeN(verts);
+	MEM_freeN(edgeNumFaces);
+	MEM_freeN(vertNumFaces);
+}
+
+/* a full sync through the per element calls, for a topology change of a
+ * mesh that has elements: the unchanged ones keep their pointers, ages and
+ * level data and only the faces around the changes are refined again */
+static void ccgSubSurf__syncMeshElements(CCGSubSurf *ss,
+                                         const void *vertData, int vertStride, int numVerts,
+                                         const int (*edgeVerts)[2], const float *edgeCreases, int numEdges,
+                                         const int *faceOffsets, const int *faceVerts, int numFaces)
 {
-	int subdivLevels = ss->subdivLevels;
-	int edgeSize = ccg_edgesize(curLvl);
-	int gridSize = ccg_gridsize(curLvl);
-	int nextLvl = curLvl + 1;
-	int ptrIdx, cornerIdx, i;
-	int vertDataSize = ss->meshIFC.vertDataSize;
-	float *q = ss->q, *r = ss->r;
+	CCGVertHDL *fVerts;
+	int i, S, maxFaceVerts = 0;
 
-#pragma omp parallel for private(ptrIdx) if (numEffectedF * edgeSize * edgeSize * 4 >= CCG_OMP_LIMIT)
-	for (ptrIdx = 0; ptrIdx < numEffectedF; ptrIdx++) {
-		CCGFace *f = (CCGFace *) effectedF[ptrIdx];
-		int S, x, y;
+	for (i = 0; i < numFaces; i++)
+		maxFaceVerts = MAX2(maxFaceVerts, faceOffsets[i + 1] - faceOffsets[i]);
+	fVerts = MEM_mallocN(sizeof(*fVerts) * MAX2(maxFaceVerts, 1), "CCGSubsurf fVerts");
 
-		/* interior face midpoints
-		 * - old interior face points
-		 */
-		for (S = 0; S < f->numVerts; S++) {
-			for (y = 0; y < gridSize - 1; y++) {
-				for (x = 0; x < gridSize - 1; x++) {
-					int fx = 1 + 2 * x;
-					int fy = 1 + 2 * y;
-					const float *co0 = FACE_getIFCo(f, curLvl, S, x + 0, y + 0);
-					const float *co1 = FACE_getIFCo(f, curLvl, S, x + 1, y + 0);
-					const float *co2 = FACE_getIFCo(f, curLvl, S, x + 1, y + 1);
-					const float *co3 = FACE_getIFCo(f, curLvl, S, x + 0, y + 1);
-					float *co = FACE_getIFCo(f, nextLvl, S, fx, fy);
+	ccgSubSurf_initFullSync(ss);
 
-					VertDataAvg4(co, co0, co1, co2, co3, ss);
-				}
-			}
-		}
+	for (i = 0; i < numVerts; i++) {
+		ccgSubSurf_syncVert(ss, SET_INT_IN_POINTER(i),
+		                    (const byte *) vertData + (size_t) i * vertStride, 0, NULL);
+	}
+	for (i = 0; i < numEdges; i++) {
+		ccgSubSurf_syncEdge(ss, SET_INT_IN_POINTER(i), SET_INT_IN_POINTER(edgeVerts[i][0]),
+		                    SET_INT_IN_POINTER(edgeVerts[i][1]), edgeCreases[i], NULL);
+	}
+	for (i = 0; i < numFaces; i++) {
+		int numFaceVerts = faceOffsets[i + 1] - faceOffsets[i];
 
-		/* interior edge midpoints
-		 * - old interior edge points
-		 * - new interior face midpoints
+		for (S = 0; S < numFaceVerts; S++)
+			fVerts[S] = SET_INT_IN_POINTER(faceVerts[faceOffsets[i] + S]);
+		ccgSubSurf_syncFace(ss, SET_INT_IN_POINTER(i), numFaceVerts, fVerts, NULL);
+	}
+
+	ccgSubSurf_processSync(ss);
+
+	MEM_freeN(fVerts);
+}
+
+/* Full sync from mesh arrays in one call, for callers that have the whole
+ * mesh at hand. Vertex, edge and face i get the handle SET_INT_IN_POINTER(i).
+ * vertData holds the numLayers floats of each vertex, vertStride bytes
+ * apart. Face i has the corners faceVerts[faceOffsets[i]] up to
+ * faceVerts[faceOffsets[i + 1]], at least three, and every face side has
+ * to be one of the edges.
+ *
+ * When the topology is that of the last sync only the vertex data and the
+ * creases are compared. A mesh without elements is built from the arrays
+ * without the per element hash lookups, edge searches and reallocations of
+ * the sync calls. Other topology changes go through those calls, which keep
+ * the elements that didn't change. The result is that of the equivalent
+ * full sync. */
+CCGError ccgSubSurf_syncMesh(CCGSubSurf *ss,
+                             const void *vertData, int vertStride, int numVerts,
+                             const int (*edgeVerts)[2], const float *edgeCreases, int numEdges,
+                             const int *faceOffsets, const int *faceVerts, int numFaces)
+{
+	int i;
+
+	if (ss->syncState != eSyncState_None) {
+		return eCCGError_InvalidSyncState;
+	}
+	else if (numVerts < 0 || numEdges < 0 || numFaces < 0 || faceOffsets[0] != 0) {
+		return eCCGError_InvalidValue;
+	}
+
+	for (i = 0; i < numFaces; i++) {
+		if (faceOffsets[i + 1] - faceOffsets[i] < 3)
+			return eCCGError_InvalidValue;
+	}
+
+	if (ccgSubSurf__isSyncedMesh(ss, numVerts, edgeVerts, numEdges, faceOffsets, faceVerts, numFaces)) {
+		ss->currentAge++;
+		ccgSubSurf__updateMesh(ss, vertData, vertStride, numVerts, edgeCreases, numEdges, numFaces);
+		ccgSubSurf__sync(ss);
+	}
+	else {
+		int *vertEdgeStart, *vertEdges, *loopEdges;
+
+		/* nothing changes when the arrays don't make a mesh */
+		if (!ccgSubSurf__matchMesh(numVerts, edgeVerts, numEdges, faceOffsets, faceVerts, numFaces,
+		                           &vertEdgeStart, &vertEdges, &loopEdges))
+		{
+			return eCCGError_InvalidValue;
+		}
+
+		if (ss->vMap->numEntries || ss->eMap->numEntries || ss->fMap->numEntries) {
+			ccgSubSurf__syncMeshElements(ss, vertData, vertStride, numVerts, edgeVerts, edgeCreases, numEdges,
+			                             faceOffsets, faceVerts, numFaces);
+		}
+		else {
+			ss->currentAge++;
+			ccgSubSurf__dropPending(ss);
+			ccgSubSurf__buildMesh(ss, vertData, vertStride, numVerts, edgeVerts, edgeCreases, numEdges,
+			                      faceOffsets, faceVerts, numFaces, vertEdgeStart, loopEdges);
+			ccgSubSurf__sync(ss);
+		}
+
+		MEM_freeN(loopEdges);
+		MEM_freeN(vertEdges);
+		MEM_freeN(vertEdgeStart);
+	}
+
+	return eCCGError_None;
+}
+
+#define VERT_getCo(v, lvl)                  _vert_getCo(v, lvl, vertDataSize)
+#define VERT_getNo(e, lvl)                  _vert_getNo(v, lvl, vertDataSize, normalDataOffset)
+#define EDGE_getCo(e, lvl, x)               _edge_getCo(e, lvl, x, vertDataSize)
+#define EDGE_getNo(e, lvl, x)               _edge_getNo(e, lvl, x, vertDataSize, normalDataOffset)
+#define FACE_getIFNo(f, lvl, S, x, y)       _face_getIFNo(f, lvl, S, x, y, subdivLevels, vertDataSize, normalDataOffset)
+#define FACE_calcIFNo(f, lvl, S, x, y, no)  _face_calcIFNo(f, lvl, S, x, y, no, subdivLevels, vertDataSize)
+#define FACE_getIENo(f, lvl, S, x)          _face_getIENo(f, lvl, S, x, subdivLevels, vertDataSize, normalDataOffset)
+
+/* Normals
+ *
+ * The normal of a sample is the sum of the normals of the quads around it.
+ * Each face computes the normals of its quads once into a buffer and gathers
+ * them into its samples, the ones inside the face are complete then. The
+ * samples on the edges and at the corners also have quads in the other
+ * faces around them, there the face leaves its part of the sum, and
+ * ccgSubSurf__stitchNormals adds up the parts in the order of e->faces and
+ * v->faces. Every sample is written by one face, edge or vertex only, so
+ * both passes run in parallel and give the same result with any number of
+ * threads. Samples on edges and at vertices that aren't effected keep their
+ * normals. */
+
+#define QUAD_getNo(S, x, y)  quadNo[((S) * (gridSize - 1) + (y)) * (gridSize - 1) + (x)]
+
+static void ccgSubSurf__calcFaceNormals(CCGSubSurf *ss, CCGFace *f, int lvl, float (*quadNo)[3])
+{
+	int subdivLevels = ss->subdivLevels;
+	int gridSize = ccg_gridsize(lvl);
+	int normalDataOffset = ss->normalDataOffset;
+	int vertDataSize = ss->meshIFC.vertDataSize;
+	int numVerts = f->numVerts;
+	float *no;
+	int S, x, y;
+
+	for (S = 0; S < numVerts; S++) {
+		for (y = 0; y < gridSize - 1; y++) {
+			for (x = 0; x < gridSize - 1; x++) {
+				FACE_calcIFNo(f, lvl, S, x, y, QUAD_getNo(S, x, y));
+			}
+		}
+	}
+
+	/* the center is shared by all grids */
+	no = FACE_getIFNo(f, lvl, 0, 0, 0);
+	NormZero(no);
+	for (S = 0; S < numVerts; S++) {
+		NormAdd(no, QUAD_getNo(S, 0, 0));
+	}
+	Normalize(no);
+	for (S = 1; S < numVerts; S++) {
+		NormCopy(FACE_getIFNo(f, lvl, S, 0, 0), no);
+	}
+	NormCopy((float *) ((byte *) FACE_getCenterData(f) + normalDataOffset), no);
+
+	for (S = 0; S < numVerts; S++) {
+		int next = (S + 1) % numVerts;
+
+		for (y = 1; y < gridSize - 1; y++) {
+			for (x = 1; x < gridSize - 1; x++) {
+				no = FACE_getIFNo(f, lvl, S, x, y);
+				NormCopy(no, QUAD_getNo(S, x - 1, y - 1));
+				NormAdd(no, QUAD_getNo(S, x + 0, y - 1));
+				NormAdd(no, QUAD_getNo(S, x - 1, y + 0));
+				NormAdd(no, QUAD_getNo(S, x + 0, y + 0));
+				Normalize(no);
+			}
+		}
+
+		/* the first row is shared with the first column of the next grid */
+		for (x = 1; x < gridSize - 1; x++) {
+			no = FACE_getIFNo(f, lvl, S, x, 0);
+			NormCopy(no, QUAD_getNo(S, x - 1, 0));
+			NormAdd(no, QUAD_getNo(S, x + 0, 0));
+			NormAdd(no, QUAD_getNo(next, 0, x - 1));
+			NormAdd(no, QUAD_getNo(next, 0, x + 0));
+			Normalize(no);
+			NormCopy(FACE_getIFNo(f, lvl, next, 0, x), no);
+			NormCopy(FACE_getIENo(f, lvl, S, x), no);
+		}
+
+		/* the part of f in the samples on edge S, up to its midpoint, and on
+		 * edge S - 1 and at vertex S */
+		if (FACE_getEdges(f)[S]->flags & Edge_eEffected) {
+			for (y = 1; y < gridSize - 1; y++) {
+				no = FACE_getIFNo(f, lvl, S, gridSize - 1, y);
+				NormCopy(no, QUAD_getNo(S, gridSize - 2, y - 1));
+				NormAdd(no, QUAD_getNo(S, gridSize - 2, y + 0));
+			}
+			no = FACE_getIFNo(f, lvl, S, gridSize - 1, 0);
+			NormCopy(no, QUAD_getNo(S, gridSize - 2, 0));
+			NormAdd(no, QUAD_getNo(next, 0, gridSize - 2));
+		}
+		if (FACE_getEdges(f)[(S - 1 + numVerts) % numVerts]->flags & Edge_eEffected) {
+			for (x = 1; x < gridSize - 1; x++) {
+				no = FACE_getIFNo(f, lvl, S, x, gridSize - 1);
+				NormCopy(no, QUAD_getNo(S, x - 1, gridSize - 2));
+				NormAdd(no, QUAD_getNo(S, x + 0, gridSize - 2));
+			}
+		}
+		if (FACE_getVerts(f)[S]->flags & Vert_eEffected) {
+			NormCopy(FACE_getIFNo(f, lvl, S, gridSize - 1, gridSize - 1), QUAD_getNo(S, gridSize - 2, gridSize - 2));
+		}
+	}
+}
+
+#undef QUAD_getNo
+
+/* Add up the parts the faces left in the samples on the effected edges and
+ * at the effected vertices, see ccgSubSurf__calcFaceNormals. */
+static void ccgSubSurf__stitchNormals(CCGSubSurf *ss,
+                                      CCGVert **effectedV, CCGEdge **effectedE,
+                                      int numEffectedV, int numEffectedE, int lvl)
+{
+	int subdivLevels = ss->subdivLevels;
+	int edgeSize = ccg_edgesize(lvl);
+	int gridSize = ccg_gridsize(lvl);
+	int normalDataOffset = ss->normalDataOffset;
+	int vertDataSize = ss->meshIFC.vertDataSize;
+	/* an edge adds up and copies back its samples of two faces mostly */
+#ifdef _OPENMP
+	int numThreads = ccgSubSurf__numThreads(ss, (size_t) numEffectedE * edgeSize * 4);
+#endif
+	int ptrIdx;
+
+#pragma omp parallel private(ptrIdx) num_threads(numThreads) if (numThreads > 1)
+	{
+#pragma omp for schedule(guided)
+		for (ptrIdx = 0; ptrIdx < numEffectedV; ptrIdx++) {
+			CCGVert *v = (CCGVert *) effectedV[ptrIdx];
+			float *no = VERT_getNo(v, lvl);
+			int i;
+
+			NormZero(no);
+
+			for (i = 0; i < v->numFaces; i++) {
+				CCGFace *f = v->faces[i];
+				NormAdd(no, FACE_getIFNo(f, lvl, _face_getVertIndex(f, v), gridSize - 1, gridSize - 1));
+			}
+
+			if (UNLIKELY(v->numFaces == 0)) {
+				NormCopy(no, VERT_getCo(v, lvl));
+			}
+
+			Normalize(no);
+
+			for (i = 0; i < v->numFaces; i++) {
+				CCGFace *f = v->faces[i];
+				NormCopy(FACE_getIFNo(f, lvl, _face_getVertIndex(f, v), gridSize - 1, gridSize - 1), no);
+			}
+		}
+
+		/* the ends of the edges are the vertex normals from above */
+#pragma omp for schedule(guided)
+		for (ptrIdx = 0; ptrIdx < numEffectedE; ptrIdx++) {
+			CCGEdge *e = (CCGEdge *) effectedE[ptrIdx];
+			int i, x;
+
+			if (e->numFaces) {
+				for (x = 1; x < edgeSize - 1; x++) {
+					NormZero(EDGE_getNo(e, lvl, x));
+				}
+
+				for (i = 0; i < e->numFaces; i++) {
+					CCGFace *f = e->faces[i];
+					const int f_ed_idx = _face_getEdgeIndex(f, e);
+
+					for (x = 1; x < edgeSize - 1; x++) {
+						NormAdd(EDGE_getNo(e, lvl, x),
+						        _face_getIFNoEdge(f, e, f_ed_idx, lvl, x, 0, subdivLevels, vertDataSize, normalDataOffset));
+					}
+				}
+
+				for (x = 1; x < edgeSize - 1; x++) {
+					Normalize(EDGE_getNo(e, lvl, x));
+				}
+
+				for (i = 0; i < e->numFaces; i++) {
+					CCGFace *f = e->faces[i];
+					const int f_ed_idx = _face_getEdgeIndex(f, e);
+
+					for (x = 1; x < edgeSize - 1; x++) {
+						NormCopy(_face_getIFNoEdge(f, e, f_ed_idx, lvl, x, 0, subdivLevels, vertDataSize, normalDataOffset),
+						         EDGE_getNo(e, lvl, x));
+					}
+
+					/* the midpoint is in the next grid too */
+					NormCopy(FACE_getIFNo(f, lvl, (f_ed_idx + 1) % f->numVerts, 0, gridSize - 1),
+					         EDGE_getNo(e, lvl, gridSize - 1));
+				}
+
+				{
+					CCGFace *f = e->faces[0];
+					const int f_ed_idx = _face_getEdgeIndex(f, e);
+
+					NormCopy(EDGE_getNo(e, lvl, 0),
+					         _face_getIFNoEdge(f, e, f_ed_idx, lvl, 0, 0, subdivLevels, vertDataSize, normalDataOffset));
+					NormCopy(EDGE_getNo(e, lvl, edgeSize - 1),
+					         _face_getIFNoEdge(f, e, f_ed_idx, lvl, edgeSize - 1, 0, subdivLevels, vertDataSize, normalDataOffset));
+				}
+			}
+			else {
+				/* set to zero here otherwise the normals are uninitialized memory
+				 * render: tests/animation/knight.blend with valgrind.
+				 * we could be more clever and interpolate vertex normals but these are
+				 * most likely not used so just zero out. */
+				for (x = 0; x < edgeSize; x++) {
+					float *no = EDGE_getNo(e, lvl, x);
+					NormCopy(no, EDGE_getCo(e, lvl, x));
+					Normalize(no);
+				}
+			}
+		}
+	}
+}
+
+static void ccgSubSurf__calcVertNormals(CCGSubSurf *ss,
+                                        CCGVert **effectedV, CCGEdge **effectedE, CCGFace **effectedF,
+                                        int numEffectedV, int numEffectedE, int numEffectedF)
+{
+	int lvl = ss->subdivLevels;
+	int gridSize = ccg_gridsize(lvl);
+#ifdef _OPENMP
+	int numThreads = ccgSubSurf__numThreads(ss, ccgSubSurf__faceCost(effectedF, numEffectedF, lvl));
+#endif
+	int ptrIdx, maxFaceVerts = 0;
+
+	for (ptrIdx = 0; ptrIdx < numEffectedF; ptrIdx++)
+		maxFaceVerts = MAX2(maxFaceVerts, effectedF[ptrIdx]->numVerts);
+
+#pragma omp parallel private(ptrIdx) num_threads(numThreads) if (numThreads > 1)
+	{
+		float (*quadNo)[3];
+
+#pragma omp critical
+		{
+			quadNo = MEM_mallocN(sizeof(*quadNo) * MAX2(maxFaceVerts, 1) * (gridSize - 1) * (gridSize - 1), "CCGSubsurf quadNo");
+		}
+
+#pragma omp for schedule(guided)
+		for (ptrIdx = 0; ptrIdx < numEffectedF; ptrIdx++) {
+			ccgSubSurf__calcFaceNormals(ss, effectedF[ptrIdx], lvl, quadNo);
+		}
+
+#pragma omp critical
+		{
+			MEM_freeN(quadNo);
+		}
+	}
+
+	ccgSubSurf__stitchNormals(ss, effectedV, effectedE, numEffectedV, numEffectedE, lvl);
+}
+#undef FACE_getIFNo
+
+#define FACE_getIECo(f, lvl, S, x)      _face_getIECo(f, lvl, S, x, subdivLevels, vertDataSize)
+#define FACE_getIFCo(f, lvl, S, x, y)   _face_getIFCo(f, lvl, S, x, y, subdivLevels, vertDataSize)
+
+static void ccgSubSurf__calcSubdivLevel(CCGSubSurf *ss,
+                                        CCGVert **effectedV, CCGEdge **effectedE, CCGFace **effectedF,
+                                        int numEffectedV, int numEffectedE, int numEffectedF, int curLvl)
+{
+	int subdivLevels = ss->subdivLevels;
+	int edgeSize = ccg_edgesize(curLvl);
+	int gridSize = ccg_gridsize(curLvl);
+	int nextLvl = curLvl + 1;
+	int ptrIdx, i;
+	int vertDataSize = ss->meshIFC.vertDataSize;
+#ifdef _OPENMP
+	int numThreads = ccgSubSurf__numThreads(ss, ccgSubSurf__faceCost(effectedF, numEffectedF, nextLvl));
+#endif
+
+#pragma omp parallel for private(ptrIdx) num_threads(numThreads) if (numThreads > 1) schedule(guided)
+	for (ptrIdx = 0; ptrIdx < numEffectedF; ptrIdx++) {
+		CCGFace *f = (CCGFace *) effectedF[ptrIdx];
+		int S, x, y;
+
+		/* interior face midpoints
+		 * - old interior face points
+		 */
+		for (S = 0; S < f->numVerts; S++) {
+			for (y = 0; y < gridSize - 1; y++) {
+				for (x = 0; x < gridSize - 1; x++) {
+					int fx = 1 + 2 * x;
+					int fy = 1 + 2 * y;
+					const float *co0 = FACE_getIFCo(f, curLvl, S, x + 0, y + 0);
+					const float *co1 = FACE_getIFCo(f, curLvl, S, x + 1, y + 0);
+					const float *co2 = FACE_getIFCo(f, curLvl, S, x + 1, y + 1);
+					const float *co3 = FACE_getIFCo(f, curLvl, S, x + 0, y + 1);
+					float *co = FACE_getIFCo(f, nextLvl, S, fx, fy);
+
+					VertDataAvg4(co, co0, co1, co2, co3, ss);
+				}
+			}
+		}
+
+		/* interior edge midpoints
+		 * - old interior edge points
+		 * - new interior face midpoints
 		 */
 		for (S = 0; S < f->numVerts; S++) {
 			for (x = 0; x < gridSize - 1; x++) {
@@ -1780,277 +2965,296 @@ static void ccgSubSurf__calcSubdivLevel(CCGSubSurf *ss,
 		}
 	}
 
-	/* exterior edge midpoints
-	 * - old exterior edge points
-	 * - new interior face midpoints
-	 */
-	for (ptrIdx = 0; ptrIdx < numEffectedE; ptrIdx++) {
-		CCGEdge *e = (CCGEdge *) effectedE[ptrIdx];
-		float sharpness = EDGE_getSharpness(e, curLvl);
-		int x, j;
-
-		if (_edge_isBoundary(e) || sharpness > 1.0f) {
-			for (x = 0; x < edgeSize - 1; x++) {
-				int fx = x * 2 + 1;
-				const float *co0 = EDGE_getCo(e, curLvl, x + 0);
-				const float *co1 = EDGE_getCo(e, curLvl, x + 1);
-				float *co  = EDGE_getCo(e, nextLvl, fx);
+#pragma omp parallel private(ptrIdx) num_threads(numThreads) if (numThreads > 1)
+	{
+		float *q, *r;
 
-				VertDataCopy(co, co0, ss);
-				VertDataAdd(co, co1, ss);
-				VertDataMulN(co, 0.5f, ss);
-			}
+#pragma omp critical
+		{
+			q = MEM_mallocN(ss->meshIFC.vertDataSize, "CCGSubsurf q");
+			r = MEM_mallocN(ss->meshIFC.vertDataSize, "CCGSubsurf r");
 		}
-		else {
-			for (x = 0; x < edgeSize - 1; x++) {
-				int fx = x * 2 + 1;
-				const float *co0 = EDGE_getCo(e, curLvl, x + 0);
-				const float *co1 = EDGE_getCo(e, curLvl, x + 1);
-				float *co  = EDGE_getCo(e, nextLvl, fx);
-				int numFaces = 0;
 
-				VertDataCopy(q, co0, ss);
-				VertDataAdd(q, co1, ss);
+		/* exterior edge midpoints
+		 * - old exterior edge points
+		 * - new interior face midpoints
+		 */
+#pragma omp for schedule(guided)
+		for (ptrIdx = 0; ptrIdx < numEffectedE; ptrIdx++) {
+			CCGEdge *e = (CCGEdge *) effectedE[ptrIdx];
+			float sharpness = EDGE_getSharpness(e, curLvl);
+			int x, j;
 
-				for (j = 0; j < e->numFaces; j++) {
-					CCGFace *f = e->faces[j];
-					const int f_ed_idx = _face_getEdgeIndex(f, e);
-					VertDataAdd(q, _face_getIFCoEdge(f, e, f_ed_idx, nextLvl, fx, 1, subdivLevels, vertDataSize), ss);
-					numFaces++;
+			if (_edge_isBoundary(e) || sharpness > 1.0f) {
+				for (x = 0; x < edgeSize - 1; x++) {
+					int fx = x * 2 + 1;
+					const float *co0 = EDGE_getCo(e, curLvl, x + 0);
+					const float *co1 = EDGE_getCo(e, curLvl, x + 1);
+					float *co  = EDGE_getCo(e, nextLvl, fx);
+
+					VertDataCopy(co, co0, ss);
+					VertDataAdd(co, co1, ss);
+					VertDataMulN(co, 0.5f, ss);
 				}
+			}
+			else {
+				for (x = 0; x < edgeSize - 1; x++) {
+					int fx = x * 2 + 1;
+					const float *co0 = EDGE_getCo(e, curLvl, x + 0);
+					const float *co1 = EDGE_getCo(e, curLvl, x + 1);
+					float *co  = EDGE_getCo(e, nextLvl, fx);
+					int numFaces = 0;
+
+					VertDataCopy(q, co0, ss);
+					VertDataAdd(q, co1, ss);
+
+					for (j = 0; j < e->numFaces; j++) {
+						CCGFace *f = e->faces[j];
+						const int f_ed_idx = _face_getEdgeIndex(f, e);
+						VertDataAdd(q, _face_getIFCoEdge(f, e, f_ed_idx, nextLvl, fx, 1, subdivLevels, vertDataSize), ss);
+						numFaces++;
+					}
 
-				VertDataMulN(q, 1.0f / (2.0f + numFaces), ss);
+					VertDataMulN(q, 1.0f / (2.0f + numFaces), ss);
 
-				VertDataCopy(r, co0, ss);
-				VertDataAdd(r, co1, ss);
-				VertDataMulN(r, 0.5f, ss);
+					VertDataCopy(r, co0, ss);
+					VertDataAdd(r, co1, ss);
+					VertDataMulN(r, 0.5f, ss);
 
-				VertDataCopy(co, q, ss);
-				VertDataSub(r, q, ss);
-				VertDataMulN(r, sharpness, ss);
-				VertDataAdd(co, r, ss);
+					VertDataCopy(co, q, ss);
+					VertDataSub(r, q, ss);
+					VertDataMulN(r, sharpness, ss);
+					VertDataAdd(co, r, ss);
+				}
 			}
 		}
-	}
 
-	/* exterior vertex shift
-	 * - old vertex points (shifting)
-	 * - old exterior edge points
-	 * - new interior face midpoints
-	 */
-	for (ptrIdx = 0; ptrIdx < numEffectedV; ptrIdx++) {
-		CCGVert *v = (CCGVert *) effectedV[ptrIdx];
-		const float *co = VERT_getCo(v, curLvl);
-		float *nCo = VERT_getCo(v, nextLvl);
-		int sharpCount = 0, allSharp = 1;
-		float avgSharpness = 0.0;
-		int j, seam = VERT_seam(v), seamEdges = 0;
+		/* exterior vertex shift
+		 * - old vertex points (shifting)
+		 * - old exterior edge points
+		 * - new interior face midpoints
+		 */
+#pragma omp for schedule(guided)
+		for (ptrIdx = 0; ptrIdx < numEffectedV; ptrIdx++) {
+			CCGVert *v = (CCGVert *) effectedV[ptrIdx];
+			const float *co = VERT_getCo(v, curLvl);
+			float *nCo = VERT_getCo(v, nextLvl);
+			int sharpCount = 0, allSharp = 1;
+			float avgSharpness = 0.0;
+			int j, seam = VERT_seam(v), seamEdges = 0;
 
-		for (j = 0; j < v->numEdges; j++) {
-			CCGEdge *e = v->edges[j];
-			float sharpness = EDGE_getSharpness(e, curLvl);
+			for (j = 0; j < v->numEdges; j++) {
+				CCGEdge *e = v->edges[j];
+				float sharpness = EDGE_getSharpness(e, curLvl);
 
-			if (seam && _edge_isBoundary(e))
-				seamEdges++;
+				if (seam && _edge_isBoundary(e))
+					seamEdges++;
 
-			if (sharpness != 0.0f) {
-				sharpCount++;
-				avgSharpness += sharpness;
-			}
-			else {
-				allSharp = 0;
+				if (sharpness != 0.0f) {
+					sharpCount++;
+					avgSharpness += sharpness;
+				}
+				else {
+					allSharp = 0;
+				}
 			}
-		}
 
-		if (sharpCount) {
-			avgSharpness /= sharpCount;
-			if (avgSharpness > 1.0f) {
-				avgSharpness = 1.0f;
+			if (sharpCount) {
+				avgSharpness /= sharpCount;
+				if (avgSharpness > 1.0f) {
+					avgSharpness = 1.0f;
+				}
 			}
-		}
-
-		if (seamEdges < 2 || seamEdges != v->numEdges)
-			seam = 0;
 
-		if (!v->numEdges || ss->meshIFC.simpleSubdiv) {
-			VertDataCopy(nCo, co, ss);
-		}
-		else if (_vert_isBoundary(v)) {
-			int numBoundary = 0;
+			if (seamEdges < 2 || seamEdges != v->numEdges)
+				seam = 0;
 
-			VertDataZero(r, ss);
-			for (j = 0; j < v->numEdges; j++) {
-				CCGEdge *e = v->edges[j];
-				if (_edge_isBoundary(e)) {
-					VertDataAdd(r, _edge_getCoVert(e, v, curLvl, 1, vertDataSize), ss);
-					numBoundary++;
-				}
+			if (!v->numEdges || ss->meshIFC.simpleSubdiv) {
+				VertDataCopy(nCo, co, ss);
 			}
+			else if (_vert_isBoundary(v)) {
+				int numBoundary = 0;
 
-			VertDataCopy(nCo, co, ss);
-			VertDataMulN(nCo, 0.75f, ss);
-			VertDataMulN(r, 0.25f / numBoundary, ss);
-			VertDataAdd(nCo, r, ss);
-		}
-		else {
-			int cornerIdx = (1 + (1 << (curLvl))) - 2;
-			int numEdges = 0, numFaces = 0;
+				VertDataZero(r, ss);
+				for (j = 0; j < v->numEdges; j++) {
+					CCGEdge *e = v->edges[j];
+					if (_edge_isBoundary(e)) {
+						VertDataAdd(r, _edge_getCoVert(e, v, curLvl, 1, vertDataSize), ss);
+						numBoundary++;
+					}
+				}
 
-			VertDataZero(q, ss);
-			for (j = 0; j < v->numFaces; j++) {
-				CCGFace *f = v->faces[j];
-				VertDataAdd(q, FACE_getIFCo(f, nextLvl, _face_getVertIndex(f, v), cornerIdx, cornerIdx), ss);
-				numFaces++;
-			}
-			VertDataMulN(q, 1.0f / numFaces, ss);
-			VertDataZero(r, ss);
-			for (j = 0; j < v->numEdges; j++) {
-				CCGEdge *e = v->edges[j];
-				VertDataAdd(r, _edge_getCoVert(e, v, curLvl, 1, vertDataSize), ss);
-				numEdges++;
+				VertDataCopy(nCo, co, ss);
+				VertDataMulN(nCo, 0.75f, ss);
+				VertDataMulN(r, 0.25f / numBoundary, ss);
+				VertDataAdd(nCo, r, ss);
 			}
-			VertDataMulN(r, 1.0f / numEdges, ss);
-
-			VertDataCopy(nCo, co, ss);
-			VertDataMulN(nCo, numEdges - 2.0f, ss);
-			VertDataAdd(nCo, q, ss);
-			VertDataAdd(nCo, r, ss);
-			VertDataMulN(nCo, 1.0f / numEdges, ss);
-		}
+			else {
+				int cornerIdx = (1 + (1 << (curLvl))) - 2;
+				int numEdges = 0, numFaces = 0;
 
-		if ((sharpCount > 1 && v->numFaces) || seam) {
-			VertDataZero(q, ss);
+				VertDataZero(q, ss);
+				for (j = 0; j < v->numFaces; j++) {
+					CCGFace *f = v->faces[j];
+					VertDataAdd(q, FACE_getIFCo(f, nextLvl, _face_getVertIndex(f, v), cornerIdx, cornerIdx), ss);
+					numFaces++;
+				}
+				VertDataMulN(q, 1.0f / numFaces, ss);
+				VertDataZero(r, ss);
+				for (j = 0; j < v->numEdges; j++) {
+					CCGEdge *e = v->edges[j];
+					VertDataAdd(r, _edge_getCoVert(e, v, curLvl, 1, vertDataSize), ss);
+					numEdges++;
+				}
+				VertDataMulN(r, 1.0f / numEdges, ss);
 
-			if (seam) {
-				avgSharpness = 1.0f;
-				sharpCount = seamEdges;
-				allSharp = 1;
+				VertDataCopy(nCo, co, ss);
+				VertDataMulN(nCo, numEdges - 2.0f, ss);
+				VertDataAdd(nCo, q, ss);
+				VertDataAdd(nCo, r, ss);
+				VertDataMulN(nCo, 1.0f / numEdges, ss);
 			}
 
-			for (j = 0; j < v->numEdges; j++) {
-				CCGEdge *e = v->edges[j];
-				float sharpness = EDGE_getSharpness(e, curLvl);
+			if ((sharpCount > 1 && v->numFaces) || seam) {
+				VertDataZero(q, ss);
 
 				if (seam) {
-					if (_edge_isBoundary(e))
-						VertDataAdd(q, _edge_getCoVert(e, v, curLvl, 1, vertDataSize), ss);
+					avgSharpness = 1.0f;
+					sharpCount = seamEdges;
+					allSharp = 1;
 				}
-				else if (sharpness != 0.0f) {
-					VertDataAdd(q, _edge_getCoVert(e, v, curLvl, 1, vertDataSize), ss);
-				}
-			}
 
-			VertDataMulN(q, (float) 1 / sharpCount, ss);
-
-			if (sharpCount != 2 || allSharp) {
-				/* q = q + (co - q) * avgSharpness */
-				VertDataCopy(r, co, ss);
-				VertDataSub(r, q, ss);
-				VertDataMulN(r, avgSharpness, ss);
-				VertDataAdd(q, r, ss);
-			}
+				for (j = 0; j < v->numEdges; j++) {
+					CCGEdge *e = v->edges[j];
+					float sharpness = EDGE_getSharpness(e, curLvl);
 
-			/* r = co * 0.75 + q * 0.25 */
-			VertDataCopy(r, co, ss);
-			VertDataMulN(r, 0.75f, ss);
-			VertDataMulN(q, 0.25f, ss);
-			VertDataAdd(r, q, ss);
+					if (seam) {
+						if (_edge_isBoundary(e))
+							VertDataAdd(q, _edge_getCoVert(e, v, curLvl, 1, vertDataSize), ss);
+					}
+					else if (sharpness != 0.0f) {
+						VertDataAdd(q, _edge_getCoVert(e, v, curLvl, 1, vertDataSize), ss);
+					}
+				}
 
-			/* nCo = nCo + (r - nCo) * avgSharpness */
-			VertDataSub(r, nCo, ss);
-			VertDataMulN(r, avgSharpness, ss);
-			VertDataAdd(nCo, r, ss);
-		}
-	}
+				VertDataMulN(q, (float) 1 / sharpCount, ss);
 
-	/* exterior edge interior shift
-	 * - old exterior edge midpoints (shifting)
-	 * - old exterior edge midpoints
-	 * - new interior face midpoints
-	 */
-	for (ptrIdx = 0; ptrIdx < numEffectedE; ptrIdx++) {
-		CCGEdge *e = (CCGEdge *) effectedE[ptrIdx];
-		float sharpness = EDGE_getSharpness(e, curLvl);
-		int sharpCount = 0;
-		float avgSharpness = 0.0;
-		int x, j;
+				if (sharpCount != 2 || allSharp) {
+					/* q = q + (co - q) * avgSharpness */
+					VertDataCopy(r, co, ss);
+					VertDataSub(r, q, ss);
+					VertDataMulN(r, avgSharpness, ss);
+					VertDataAdd(q, r, ss);
+				}
 
-		if (sharpness != 0.0f) {
-			sharpCount = 2;
-			avgSharpness += sharpness;
+				/* r = co * 0.75 + q * 0.25 */
+				VertDataCopy(r, co, ss);
+				VertDataMulN(r, 0.75f, ss);
+				VertDataMulN(q, 0.25f, ss);
+				VertDataAdd(r, q, ss);
 
-			if (avgSharpness > 1.0f) {
-				avgSharpness = 1.0f;
+				/* nCo = nCo + (r - nCo) * avgSharpness */
+				VertDataSub(r, nCo, ss);
+				VertDataMulN(r, avgSharpness, ss);
+				VertDataAdd(nCo, r, ss);
 			}
 		}
-		else {
-			sharpCount = 0;
-			avgSharpness = 0;
-		}
 
-		if (_edge_isBoundary(e)) {
-			for (x = 1; x < edgeSize - 1; x++) {
-				int fx = x * 2;
-				const float *co = EDGE_getCo(e, curLvl, x);
-				float *nCo = EDGE_getCo(e, nextLvl, fx);
+		/* exterior edge interior shift
+		 * - old exterior edge midpoints (shifting)
+		 * - old exterior edge midpoints
+		 * - new interior face midpoints
+		 */
+#pragma omp for schedule(guided)
+		for (ptrIdx = 0; ptrIdx < numEffectedE; ptrIdx++) {
+			CCGEdge *e = (CCGEdge *) effectedE[ptrIdx];
+			float sharpness = EDGE_getSharpness(e, curLvl);
+			int sharpCount = 0;
+			float avgSharpness = 0.0;
+			int x, j;
 
-				/* Average previous level's endpoints */
-				VertDataCopy(r, EDGE_getCo(e, curLvl, x - 1), ss);
-				VertDataAdd(r, EDGE_getCo(e, curLvl, x + 1), ss);
-				VertDataMulN(r, 0.5f, ss);
+			if (sharpness != 0.0f) {
+				sharpCount = 2;
+				avgSharpness += sharpness;
 
-				/* nCo = nCo * 0.75 + r * 0.25 */
-				VertDataCopy(nCo, co, ss);
-				VertDataMulN(nCo, 0.75f, ss);
-				VertDataMulN(r, 0.25f, ss);
-				VertDataAdd(nCo, r, ss);
+				if (avgSharpness > 1.0f) {
+					avgSharpness = 1.0f;
+				}
+			}
+			else {
+				sharpCount = 0;
+				avgSharpness = 0;
 			}
-		}
-		else {
-			for (x = 1; x < edgeSize - 1; x++) {
-				int fx = x * 2;
-				const float *co = EDGE_getCo(e, curLvl, x);
-				float *nCo = EDGE_getCo(e, nextLvl, fx);
-				int numFaces = 0;
 
-				VertDataZero(q, ss);
-				VertDataZero(r, ss);
-				VertDataAdd(r, EDGE_getCo(e, curLvl, x - 1), ss);
-				VertDataAdd(r, EDGE_getCo(e, curLvl, x + 1), ss);
-				for (j = 0; j < e->numFaces; j++) {
-					CCGFace *f = e->faces[j];
-					int f_ed_idx = _face_getEdgeIndex(f, e);
-					VertDataAdd(q, _face_getIFCoEdge(f, e, f_ed_idx, nextLvl, fx - 1, 1, subdivLevels, vertDataSize), ss);
-					VertDataAdd(q, _face_getIFCoEdge(f, e, f_ed_idx, nextLvl, fx + 1, 1, subdivLevels, vertDataSize), ss);
-
-					VertDataAdd(r, _face_getIFCoEdge(f, e, f_ed_idx, curLvl, x, 1, subdivLevels, vertDataSize), ss);
-					numFaces++;
-				}
-				VertDataMulN(q, 1.0f / (numFaces * 2.0f), ss);
-				VertDataMulN(r, 1.0f / (2.0f + numFaces), ss);
+			if (_edge_isBoundary(e)) {
+				for (x = 1; x < edgeSize - 1; x++) {
+					int fx = x * 2;
+					const float *co = EDGE_getCo(e, curLvl, x);
+					float *nCo = EDGE_getCo(e, nextLvl, fx);
 
-				VertDataCopy(nCo, co, ss);
-				VertDataMulN(nCo, (float) numFaces, ss);
-				VertDataAdd(nCo, q, ss);
-				VertDataAdd(nCo, r, ss);
-				VertDataMulN(nCo, 1.0f / (2 + numFaces), ss);
+					/* Average previous level's endpoints */
+					VertDataCopy(r, EDGE_getCo(e, curLvl, x - 1), ss);
+					VertDataAdd(r, EDGE_getCo(e, curLvl, x + 1), ss);
+					VertDataMulN(r, 0.5f, ss);
 
-				if (sharpCount == 2) {
-					VertDataCopy(q, co, ss);
-					VertDataMulN(q, 6.0f, ss);
-					VertDataAdd(q, EDGE_getCo(e, curLvl, x - 1), ss);
-					VertDataAdd(q, EDGE_getCo(e, curLvl, x + 1), ss);
-					VertDataMulN(q, 1 / 8.0f, ss);
+					/* nCo = nCo * 0.75 + r * 0.25 */
+					VertDataCopy(nCo, co, ss);
+					VertDataMulN(nCo, 0.75f, ss);
+					VertDataMulN(r, 0.25f, ss);
+					VertDataAdd(nCo, r, ss);
+				}
+			}
+			else {
+				for (x = 1; x < edgeSize - 1; x++) {
+					int fx = x * 2;
+					const float *co = EDGE_getCo(e, curLvl, x);
+					float *nCo = EDGE_getCo(e, nextLvl, fx);
+					int numFaces = 0;
+
+					VertDataZero(q, ss);
+					VertDataZero(r, ss);
+					VertDataAdd(r, EDGE_getCo(e, curLvl, x - 1), ss);
+					VertDataAdd(r, EDGE_getCo(e, curLvl, x + 1), ss);
+					for (j = 0; j < e->numFaces; j++) {
+						CCGFace *f = e->faces[j];
+						int f_ed_idx = _face_getEdgeIndex(f, e);
+						VertDataAdd(q, _face_getIFCoEdge(f, e, f_ed_idx, nextLvl, fx - 1, 1, subdivLevels, vertDataSize), ss);
+						VertDataAdd(q, _face_getIFCoEdge(f, e, f_ed_idx, nextLvl, fx + 1, 1, subdivLevels, vertDataSize), ss);
+
+						VertDataAdd(r, _face_getIFCoEdge(f, e, f_ed_idx, curLvl, x, 1, subdivLevels, vertDataSize), ss);
+						numFaces++;
+					}
+					VertDataMulN(q, 1.0f / (numFaces * 2.0f), ss);
+					VertDataMulN(r, 1.0f / (2.0f + numFaces), ss);
 
-					VertDataSub(q, nCo, ss);
-					VertDataMulN(q, avgSharpness, ss);
+					VertDataCopy(nCo, co, ss);
+					VertDataMulN(nCo, (float) numFaces, ss);
 					VertDataAdd(nCo, q, ss);
+					VertDataAdd(nCo, r, ss);
+					VertDataMulN(nCo, 1.0f / (2 + numFaces), ss);
+
+					if (sharpCount == 2) {
+						VertDataCopy(q, co, ss);
+						VertDataMulN(q, 6.0f, ss);
+						VertDataAdd(q, EDGE_getCo(e, curLvl, x - 1), ss);
+						VertDataAdd(q, EDGE_getCo(e, curLvl, x + 1), ss);
+						VertDataMulN(q, 1 / 8.0f, ss);
+
+						VertDataSub(q, nCo, ss);
+						VertDataMulN(q, avgSharpness, ss);
+						VertDataAdd(nCo, q, ss);
+					}
 				}
 			}
 		}
+#pragma omp critical
+		{
+			MEM_freeN(q);
+			MEM_freeN(r);
+		}
 	}
 
-#pragma omp parallel private(ptrIdx) if (numEffectedF * edgeSize * edgeSize * 4 >= CCG_OMP_LIMIT)
+#pragma omp parallel private(ptrIdx) num_threads(numThreads) if (numThreads > 1)
 	{
 		float *q, *r;
 
@@ -2060,7 +3264,7 @@ static void ccgSubSurf__calcSubdivLevel(CCGSubSurf *ss,
 			r = MEM_mallocN(ss->meshIFC.vertDataSize, "CCGSubsurf r");
 		}
 
-#pragma omp for schedule(static)
+#pragma omp for schedule(guided)
 		for (ptrIdx = 0; ptrIdx < numEffectedF; ptrIdx++) {
 			CCGFace *f = (CCGFace *) effectedF[ptrIdx];
 			int S, x, y;
@@ -2160,43 +3364,285 @@ static void ccgSubSurf__calcSubdivLevel(CCGSubSurf *ss,
 
 	/* copy down */
 	edgeSize = ccg_edgesize(nextLvl);
-	gridSize = ccg_gridsize(nextLvl);
-	cornerIdx = gridSize - 1;
 
-#pragma omp parallel for private(i) if (numEffectedF * edgeSize * edgeSize * 4 >= CCG_OMP_LIMIT)
+#pragma omp parallel for private(i) num_threads(numThreads) if (numThreads > 1) schedule(guided)
 	for (i = 0; i < numEffectedE; i++) {
 		CCGEdge *e = effectedE[i];
 		VertDataCopy(EDGE_getCo(e, nextLvl, 0), VERT_getCo(e->v0, nextLvl), ss);
 		VertDataCopy(EDGE_getCo(e, nextLvl, edgeSize - 1), VERT_getCo(e->v1, nextLvl), ss);
 	}
+}
+
+/* Copy the new vertex and edge points of curLvl + 1 into the boundaries of the
+ * face grids. Kept apart from ccgSubSurf__calcSubdivLevel since it needs the
+ * vertices and edges of the face done, not only the face itself.
+ *
+ * A face grid is complete here, so with calcNormals the face normals of
+ * curLvl + 1 are calculated right after while the grid is still in cache,
+ * instead of reading it all again in ccgSubSurf__calcVertNormals. The
+ * caller stitches them with ccgSubSurf__stitchNormals. */
+static void ccgSubSurf__copyDownFaces(CCGSubSurf *ss, CCGFace **effectedF, int numEffectedF, int curLvl, int calcNormals)
+{
+	int subdivLevels = ss->subdivLevels;
+	int nextLvl = curLvl + 1;
+	int gridSize = ccg_gridsize(nextLvl);
+	int cornerIdx = gridSize - 1;
+	int vertDataSize = ss->meshIFC.vertDataSize;
+#ifdef _OPENMP
+	int numThreads = ccgSubSurf__numThreads(ss, ccgSubSurf__faceCost(effectedF, numEffectedF, nextLvl));
+#endif
+	int i, maxFaceVerts = 0;
+
+	if (calcNormals) {
+		for (i = 0; i < numEffectedF; i++)
+			maxFaceVerts = MAX2(maxFaceVerts, effectedF[i]->numVerts);
+	}
+
+#pragma omp parallel private(i) num_threads(numThreads) if (numThreads > 1)
+	{
+		float (*quadNo)[3] = NULL;
+
+		if (calcNormals) {
+#pragma omp critical
+			{
+				quadNo = MEM_mallocN(sizeof(*quadNo) * MAX2(maxFaceVerts, 1) * (gridSize - 1) * (gridSize - 1), "CCGSubsurf quadNo");
+			}
+		}
+
+#pragma omp for schedule(guided)
+		for (i = 0; i < numEffectedF; i++) {
+			CCGFace *f = effectedF[i];
+			int S, x;
+
+			for (S = 0; S < f->numVerts; S++) {
+				CCGEdge *e = FACE_getEdges(f)[S];
+				CCGEdge *prevE = FACE_getEdges(f)[(S + f->numVerts - 1) % f->numVerts];
+
+				VertDataCopy(FACE_getIFCo(f, nextLvl, S, 0, 0), (float *)FACE_getCenterData(f), ss);
+				VertDataCopy(FACE_getIECo(f, nextLvl, S, 0), (float *)FACE_getCenterData(f), ss);
+				VertDataCopy(FACE_getIFCo(f, nextLvl, S, cornerIdx, cornerIdx), VERT_getCo(FACE_getVerts(f)[S], nextLvl), ss);
+				VertDataCopy(FACE_getIECo(f, nextLvl, S, cornerIdx), EDGE_getCo(FACE_getEdges(f)[S], nextLvl, cornerIdx), ss);
+				for (x = 1; x < gridSize - 1; x++) {
+					float *co = FACE_getIECo(f, nextLvl, S, x);
+					VertDataCopy(FACE_getIFCo(f, nextLvl, S, x, 0), co, ss);
+					VertDataCopy(FACE_getIFCo(f, nextLvl, (S + 1) % f->numVerts, 0, x), co, ss);
+				}
+				for (x = 0; x < gridSize - 1; x++) {
+					int eI = gridSize - 1 - x;
+					VertDataCopy(FACE_getIFCo(f, nextLvl, S, cornerIdx, x), _edge_getCoVert(e, FACE_getVerts(f)[S], nextLvl, eI, vertDataSize), ss);
+					VertDataCopy(FACE_getIFCo(f, nextLvl, S, x, cornerIdx), _edge_getCoVert(prevE, FACE_getVerts(f)[S], nextLvl, eI, vertDataSize), ss);
+				}
+			}
+
+			if (calcNormals)
+				ccgSubSurf__calcFaceNormals(ss, f, nextLvl, quadNo);
+		}
+
+		if (calcNormals) {
+#pragma omp critical
+			{
+				MEM_freeN(quadNo);
+			}
+		}
+	}
+}
+
+/* Last tile with an effected face around v, a vertex can be refined once the
+ * faces of that tile got their interior face midpoints. */
+static int _vert_getTile(CCGVert *v)
+{
+	int i, tile = 0;
+
+	for (i = 0; i < v->numFaces; i++) {
+		CCGFace *f = v->faces[i];
+		if ((f->flags & Face_eEffected) && f->tile > tile)
+			tile = f->tile;
+	}
+	return tile;
+}
+static int _edge_getTile(CCGEdge *e)
+{
+	int tile0 = _vert_getTile(e->v0);
+	int tile1 = _vert_getTile(e->v1);
+
+	/* also waits for the end vertices, the copy down reads them */
+	return MAX2(tile0, tile1);
+}
+/* Last tile one of the vertices and edges of f is refined in, the grid of
+ * f can only be copied down after that. */
+static int _face_getCopyTile(CCGFace *f)
+{
+	int S, tile = 0;
+
+	for (S = 0; S < f->numVerts; S++)
+		tile = MAX2(tile, _vert_getTile(FACE_getVerts(f)[S]));
+	return tile;
+}
+
+typedef int (*CCGTileFP)(void *elem);
+
+/* Sort elements by tile, returns where the elements of each tile start in
+ * the sorted array, with one more entry for the end. */
+static int *ccgSubSurf__sortByTile(void **elems, int numElems, CCGTileFP getTile, int numTiles, void ***sorted_r)
+{
+	int *tileStart = MEM_callocN(sizeof(*tileStart) * (numTiles + 1), "CCGSubsurf tileStart");
+	int *elemTile = MEM_mallocN(sizeof(*elemTile) * MAX2(numElems, 1), "CCGSubsurf elemTile");
+	void **sorted = MEM_mallocN(sizeof(*sorted) * MAX2(numElems, 1), "CCGSubsurf sorted");
+	int i;
+
+	for (i = 0; i < numElems; i++) {
+		elemTile[i] = getTile(elems[i]);
+		tileStart[elemTile[i] + 1]++;
+	}
+	for (i = 0; i < numTiles; i++)
+		tileStart[i + 1] += tileStart[i];
+	for (i = 0; i < numElems; i++)
+		sorted[tileStart[elemTile[i]]++] = elems[i];
+	for (i = numTiles; i > 0; i--)
+		tileStart[i] = tileStart[i - 1];
+	tileStart[0] = 0;
+
+	MEM_freeN(elemTile);
+	*sorted_r = sorted;
+	return tileStart;
+}
 
-#pragma omp parallel for private(i) if (numEffectedF * edgeSize * edgeSize * 4 >= CCG_OMP_LIMIT)
+/* Refine from startLvl up to endLvl.
+ *
+ * When the face data doesn't fit in CCG_TILE_SIZE, going level by level over
+ * all faces reloads everything from memory for each level. Instead the faces
+ * are split into tiles that are taken through several levels while their
+ * data is still in cache. The vertices and edges are refined with the last
+ * tile around them and a tile only goes to the next level once the tiles it
+ * reads from at the previous level are done, so every point is computed from
+ * the same input as when going level by level, and the result is the same.
+ * This only applies when the finest level runs on one thread, otherwise the
+ * levels are done whole as before. On one thread a full sync of a 64x64 quad
+ * grid at level 4 takes about a quarter less time with this, measure with
+ * tests/ccgsubsurf_bench.c.
+ *
+ * With calcNormals the face normals of endLvl, which has to be subdivLevels,
+ * are calculated with the copy down of the last level, the caller only
+ * stitches them, see ccgSubSurf__copyDownFaces. */
+static void ccgSubSurf__calcSubdivLevels(CCGSubSurf *ss,
+                                         CCGVert **effectedV, CCGEdge **effectedE, CCGFace **effectedF,
+                                         int numEffectedV, int numEffectedE, int numEffectedF, int startLvl, int endLvl,
+                                         int calcNormals)
+{
+	int subdivLevels = ss->subdivLevels;
+	int maxGridSize = ccg_gridsize(subdivLevels);
+	int vertDataSize = ss->meshIFC.vertDataSize;
+	int tileDone[CCGSUBSURF_LEVEL_MAX + 1];
+	int *tileF, *tileV, *tileE, *tileCopyF, *tileRequired;
+	CCGVert **sortedV;
+	CCGEdge **sortedE;
+	CCGFace **sortedCopyF;
+	int i, j, k, curLvl, numTiles, tileBytes, tileSize = CCG_TILE_SIZE;
+
+	BLI_assert(!calcNormals || (startLvl < endLvl && endLvl == subdivLevels));
+
+	/* tiles are too small for the passes to go parallel, when the finest
+	 * level gets more threads the levels are better done whole */
+	if (ccgSubSurf__numThreads(ss, ccgSubSurf__faceCost(effectedF, numEffectedF, endLvl)) > 1)
+		tileSize = INT_MAX;
+
+	/* split the faces into tiles, in the order they come in */
+	tileF = MEM_mallocN(sizeof(int) * (numEffectedF + 1), "CCGSubsurf tileF");
+	numTiles = 0;
+	tileBytes = 0;
 	for (i = 0; i < numEffectedF; i++) {
 		CCGFace *f = effectedF[i];
-		int S, x;
+		int faceBytes = vertDataSize * f->numVerts * (maxGridSize + maxGridSize * maxGridSize + ccg_gridbase(subdivLevels));
 
-		for (S = 0; S < f->numVerts; S++) {
-			CCGEdge *e = FACE_getEdges(f)[S];
-			CCGEdge *prevE = FACE_getEdges(f)[(S + f->numVerts - 1) % f->numVerts];
+		if (i == 0 || faceBytes > tileSize - tileBytes) {
+			tileF[numTiles++] = i;
+			tileBytes = 0;
+		}
+		tileBytes += faceBytes;
+		f->tile = numTiles - 1;
+	}
+	tileF[numTiles] = numEffectedF;
+
+	if (numTiles <= 1 || startLvl + 1 >= endLvl) {
+		for (curLvl = startLvl; curLvl < endLvl; curLvl++) {
+			ccgSubSurf__calcSubdivLevel(ss,
+			                            effectedV, effectedE, effectedF,
+			                            numEffectedV, numEffectedE, numEffectedF, curLvl);
+			ccgSubSurf__copyDownFaces(ss, effectedF, numEffectedF, curLvl, calcNormals && curLvl + 1 == endLvl);
+		}
+		MEM_freeN(tileF);
+		return;
+	}
 
-			VertDataCopy(FACE_getIFCo(f, nextLvl, S, 0, 0), (float *)FACE_getCenterData(f), ss);
-			VertDataCopy(FACE_getIECo(f, nextLvl, S, 0), (float *)FACE_getCenterData(f), ss);
-			VertDataCopy(FACE_getIFCo(f, nextLvl, S, cornerIdx, cornerIdx), VERT_getCo(FACE_getVerts(f)[S], nextLvl), ss);
-			VertDataCopy(FACE_getIECo(f, nextLvl, S, cornerIdx), EDGE_getCo(FACE_getEdges(f)[S], nextLvl, cornerIdx), ss);
-			for (x = 1; x < gridSize - 1; x++) {
-				float *co = FACE_getIECo(f, nextLvl, S, x);
-				VertDataCopy(FACE_getIFCo(f, nextLvl, S, x, 0), co, ss);
-				VertDataCopy(FACE_getIFCo(f, nextLvl, (S + 1) % f->numVerts, 0, x), co, ss);
+	tileV = ccgSubSurf__sortByTile((void **) effectedV, numEffectedV, (CCGTileFP) _vert_getTile, numTiles, (void ***) &sortedV);
+	tileE = ccgSubSurf__sortByTile((void **) effectedE, numEffectedE, (CCGTileFP) _edge_getTile, numTiles, (void ***) &sortedE);
+	tileCopyF = ccgSubSurf__sortByTile((void **) effectedF, numEffectedF, (CCGTileFP) _face_getCopyTile, numTiles, (void ***) &sortedCopyF);
+
+	/* tile of the previous level that needs to be done before a tile can
+	 * start: the face grids of its faces, the edges around its vertices and
+	 * the faces around its edges */
+	tileRequired = MEM_callocN(sizeof(int) * numTiles, "CCGSubsurf tileRequired");
+	for (k = 0; k < numTiles; k++) {
+		for (i = tileCopyF[k]; i < tileCopyF[k + 1]; i++) {
+			CCGFace *f = sortedCopyF[i];
+			if (k > tileRequired[f->tile])
+				tileRequired[f->tile] = k;
+		}
+		for (i = tileV[k]; i < tileV[k + 1]; i++) {
+			CCGVert *v = sortedV[i];
+			for (j = 0; j < v->numEdges; j++) {
+				int tile = _edge_getTile(v->edges[j]);
+				if (tile > tileRequired[k])
+					tileRequired[k] = tile;
 			}
-			for (x = 0; x < gridSize - 1; x++) {
-				int eI = gridSize - 1 - x;
-				VertDataCopy(FACE_getIFCo(f, nextLvl, S, cornerIdx, x), _edge_getCoVert(e, FACE_getVerts(f)[S], nextLvl, eI, vertDataSize), ss);
-				VertDataCopy(FACE_getIFCo(f, nextLvl, S, x, cornerIdx), _edge_getCoVert(prevE, FACE_getVerts(f)[S], nextLvl, eI, vertDataSize), ss);
+		}
+		for (i = tileE[k]; i < tileE[k + 1]; i++) {
+			CCGEdge *e = sortedE[i];
+			for (j = 0; j < e->numFaces; j++) {
+				int tile = _face_getCopyTile(e->faces[j]);
+				if (tile > tileRequired[k])
+					tileRequired[k] = tile;
+			}
+		}
+	}
+
+	for (curLvl = startLvl; curLvl < endLvl; curLvl++)
+		tileDone[curLvl] = 0;
+
+	/* go as deep as possible after each tile of the first level, and finish
+	 * the remaining tiles of the deeper levels at the end */
+	for (k = 0; k <= numTiles; k++) {
+		for (curLvl = startLvl; curLvl < endLvl; curLvl++) {
+			while (tileDone[curLvl] < numTiles) {
+				int tile = tileDone[curLvl];
+
+				if (curLvl == startLvl) {
+					if (tile > k) break;
+				}
+				else if (k < numTiles && tileRequired[tile] >= tileDone[curLvl - 1]) {
+					break;
+				}
+
+				ccgSubSurf__calcSubdivLevel(ss,
+				                            sortedV + tileV[tile], sortedE + tileE[tile], effectedF + tileF[tile],
+				                            tileV[tile + 1] - tileV[tile], tileE[tile + 1] - tileE[tile],
+				                            tileF[tile + 1] - tileF[tile], curLvl);
+				ccgSubSurf__copyDownFaces(ss, sortedCopyF + tileCopyF[tile], tileCopyF[tile + 1] - tileCopyF[tile], curLvl,
+				                          calcNormals && curLvl + 1 == endLvl);
+				tileDone[curLvl]++;
 			}
 		}
 	}
-}
 
+	MEM_freeN(tileRequired);
+	MEM_freeN(sortedCopyF);
+	MEM_freeN(tileCopyF);
+	MEM_freeN(sortedE);
+	MEM_freeN(tileE);
+	MEM_freeN(sortedV);
+	MEM_freeN(tileV);
+	MEM_freeN(tileF);
+}
 
 static void interp0(float a[3], float P[3], float c[3], float res[3]) {
 	float ac[3], aP[3], sagitta[3];
@@ -2219,21 +3665,126 @@ static void interp0(float a[3], float P[3], float c[3], float res[3]) {
 	add(res, a, sagitta);
 }
 
-static void set_midpoint(CCGEdge *e, float res[3], float e_co[3], float *en_Cast){
-	if (e->flags & Edge_mytrigger){
-		add(res, res, e_co);
+/* Both end vertices of an edge may propose an arc midpoint for it. The
+ * proposal of v is kept in the level 1 end point slot on v's side of the
+ * edge, which is only filled in by the copy down after the level 0 passes,
+ * so vertices never write to shared data and can be handled in parallel. */
+static void set_midpoint(CCGVert *v, CCGEdge *e, float res[3], int dataSize)
+{
+	float *slot = _edge_getCoVert(e, v, 1, 0, dataSize);
+	int i;
+
+	slot[0] = res[0];
+	slot[1] = res[1];
+	slot[2] = res[2];
+
+	for (i = 0; i < v->numEdges; i++) {
+		if (v->edges[i] == e) {
+			v->arcEdges |= (1 << i);
+			break;
+		}
+	}
+}
+
+static int _vert_hasArcEdge(const CCGVert *v, const CCGEdge *e)
+{
+	int i;
+	for (i = 0; i < v->numEdges; i++)
+		if (v->edges[i] == e)
+			return (v->arcEdges & (1 << i)) != 0;
+	return 0;
+}
+
+/* Average the proposals of set_midpoint into the edge midpoint. The sum of
+ * two floats doesn't depend on their order, so this gives the same result
+ * whichever end vertex is visited first. */
+static void gather_midpoint(CCGEdge *e, float *en_Cast, int dataSize)
+{
+	int has0 = _vert_hasArcEdge(e->v0, e);
+	int has1 = _vert_hasArcEdge(e->v1, e);
+	float *p0 = _edge_getCoVert(e, e->v0, 1, 0, dataSize);
+	float *p1 = _edge_getCoVert(e, e->v1, 1, 0, dataSize);
+	float res[3];
+
+	if (has0 && has1) {
+		add(res, p1, p0);
 		scale(res, 0.5);
 	}
-	else {
-		e->flags |= Edge_mytrigger;
+	else if (has0) {
+		to_vector(p0, res);
 	}
-	if (!(e->flags & Edge_excluded)){
-		en_Cast[0] = res[0];
-		en_Cast[1] = res[1];
-		en_Cast[2] = res[2];
+	else if (has1) {
+		to_vector(p1, res);
 	}
+	else {
+		return;
+	}
+
+	en_Cast[0] = res[0];
+	en_Cast[1] = res[1];
+	en_Cast[2] = res[2];
+}
+
+
+/* Make the pending arrays list the elements without the normals when that is
+ * all of them. */
+static void ccgSubSurf__listPending(CCGSubSurf *ss)
+{
+	int i;
+
+	if (ss->pendingV)
+		return;
+
+	ss->numPendingV = ss->vMap->numEntries;
+	ss->numPendingE = ss->eMap->numEntries;
+	ss->numPendingF = ss->fMap->numEntries;
+	ss->pendingV = MEM_mallocN(sizeof(*ss->pendingV) * MAX2(ss->numPendingV, 1), "CCGSubsurf pendingV");
+	ss->pendingE = MEM_mallocN(sizeof(*ss->pendingE) * MAX2(ss->numPendingE, 1), "CCGSubsurf pendingE");
+	ss->pendingF = MEM_mallocN(sizeof(*ss->pendingF) * MAX2(ss->numPendingF, 1), "CCGSubsurf pendingF");
+
+	for (i = 0; i < ss->numPendingV; i++)
+		ss->pendingV[i] = (CCGVert *) ss->vMap->entries[i].entry;
+	for (i = 0; i < ss->numPendingE; i++)
+		ss->pendingE[i] = (CCGEdge *) ss->eMap->entries[i].entry;
+	for (i = 0; i < ss->numPendingF; i++)
+		ss->pendingF[i] = (CCGFace *) ss->fMap->entries[i].entry;
 }
 
+/* Move the pending elements over to the effected ones of a sync, the arrays
+ * have room for all elements. */
+static void ccgSubSurf__addPending(CCGSubSurf *ss,
+                                   CCGVert **effectedV, CCGEdge **effectedE, CCGFace **effectedF,
+                                   int *numEffectedV_r, int *numEffectedE_r, int *numEffectedF_r)
+{
+	int i;
+
+	ccgSubSurf__listPending(ss);
+
+	for (i = 0; i < ss->numPendingV; i++) {
+		CCGVert *v = ss->pendingV[i];
+		if (!(v->flags & Vert_eEffected)) {
+			effectedV[(*numEffectedV_r)++] = v;
+			v->flags |= Vert_eEffected;
+		}
+	}
+	for (i = 0; i < ss->numPendingE; i++) {
+		CCGEdge *e = ss->pendingE[i];
+		if (!(e->flags & Edge_eEffected)) {
+			effectedE[(*numEffectedE_r)++] = e;
+			e->flags |= Edge_eEffected;
+		}
+	}
+	for (i = 0; i < ss->numPendingF; i++) {
+		CCGFace *f = ss->pendingF[i];
+		if (!(f->flags & Face_eEffected)) {
+			effectedF[(*numEffectedF_r)++] = f;
+			f->flags |= Face_eEffected;
+		}
+	}
+
+	ccgSubSurf__dropPending(ss);
+	ss->pendingNormals = 0;
+}
 
 static void ccgSubSurf__sync(CCGSubSurf *ss)
 {
@@ -2241,72 +3792,101 @@ static void ccgSubSurf__sync(CCGSubSurf *ss)
 	CCGEdge **effectedE;
 	CCGFace **effectedF;
 	int numEffectedV, numEffectedE, numEffectedF;
+	int numSeedV, numInnerE;
 	int subdivLevels = ss->subdivLevels;
 	int vertDataSize = ss->meshIFC.vertDataSize;
-	int i, j, ptrIdx, S;
+	int deferNormals = ss->calcVertNormals && ss->lazyNormals;
+	int fuseNormals = 0;
+	int i, j, k, ptrIdx, S;
 	int curLvl, nextLvl;
-	void *q = ss->q, *r = ss->r;
+#ifdef _OPENMP
+	int numThreads;
+#endif
+
+	ccgSubSurf__beginEval(ss);
+	ccgSubSurf__packAdjacency(ss);
+	ccgSubSurf__calcRings(ss);
 
 	effectedV = MEM_mallocN(sizeof(*effectedV) * ss->vMap->numEntries, "CCGSubsurf effectedV");
 	effectedE = MEM_mallocN(sizeof(*effectedE) * ss->eMap->numEntries, "CCGSubsurf effectedE");
 	effectedF = MEM_mallocN(sizeof(*effectedF) * ss->fMap->numEntries, "CCGSubsurf effectedF");
 	numEffectedV = numEffectedE = numEffectedF = 0;
 
-/*  
-	for (i = 0; i < ss->vMap->curSize; i++) {
-		CCGVert *v = (CCGVert *) ss->vMap->buckets[i];
-		for (; v; v = v->next) {
-			if ((v->flags & Vert_eEffected) && !(v->flags & Vert_mytrigger)) {
-				//effectedV[numEffectedV++] = v;
-				for (j = 0; j < v->numEdges; j++) {
-					CCGEdge *e = v->edges[j];
-					CCGVert *v0 = e->v0;
-					CCGVert *v1 = e->v1;
+	for (i = 0; i < ss->vMap->numEntries; i++) {
+		CCGVert *v = (CCGVert *) ss->vMap->entries[i].entry;
+		if (v->flags & Vert_eEffected) {
+			effectedV[numEffectedV++] = v;
+		}
+	}
 
-					if (!(v0->flags & Vert_eEffected)) {
-						v0->flags |= Vert_mytrigger;
-						v0->flags |= Vert_eEffected;
-					}
-					if (!(v1->flags & Vert_eEffected)) {
-						v1->flags |= Vert_mytrigger;
-						v1->flags |= Vert_eEffected;
-					}
+	// the sync calls flag the vertices whose level 1 data changes. The arc passes
+	// below read the one-ring and the faces around every vertex they recompute,
+	// and the level 1 face centers they produce spread one ring further on the
+	// following levels, so grow the flagged set by that ring once
+	numSeedV = numEffectedV;
+	for (ptrIdx = 0; ptrIdx < numSeedV; ptrIdx++) {
+		CCGVert *v = effectedV[ptrIdx];
+
+		for (j = 0; j < v->numEdges; j++) {
+			CCGVert *vQ = _edge_getOtherVert(v->edges[j], v);
+			if (!(vQ->flags & Vert_eEffected)) {
+				effectedV[numEffectedV++] = vQ;
+				vQ->flags |= Vert_eEffected;
+			}
+		}
+
+		for (j = 0; j < v->numFaces; j++) {
+			CCGFace *f = v->faces[j];
+			for (k = 0; k < f->numVerts; k++) {
+				CCGVert *vQ = FACE_getVerts(f)[k];
+				if (!(vQ->flags & Vert_eEffected)) {
+					effectedV[numEffectedV++] = vQ;
+					vQ->flags |= Vert_eEffected;
 				}
 			}
 		}
 	}
-*/
 
-	for (i = 0; i < ss->vMap->curSize; i++) {
-		CCGVert *v = (CCGVert *) ss->vMap->buckets[i];
-		for (; v; v = v->next) {
-			if (1){
-//			if (v->flags & Vert_eEffected) {
-				effectedV[numEffectedV++] = v;
+	for (ptrIdx = 0; ptrIdx < numEffectedV; ptrIdx++) {
+		CCGVert *v = effectedV[ptrIdx];
 
-				for (j = 0; j < v->numEdges; j++) {
-					CCGEdge *e = v->edges[j];
-					if (!(e->flags & Edge_eEffected)) {
-						effectedE[numEffectedE++] = e;
-						e->flags |= Edge_eEffected;
-					}
-				}
+		for (j = 0; j < v->numEdges; j++) {
+			CCGEdge *e = v->edges[j];
+			if (!(e->flags & Edge_eEffected)) {
+				effectedE[numEffectedE++] = e;
+				e->flags |= Edge_eEffected;
+			}
+		}
 
-				for (j = 0; j < v->numFaces; j++) {
-					CCGFace *f = v->faces[j];
-					if (!(f->flags & Face_eEffected)) {
-						effectedF[numEffectedF++] = f;
-						f->flags |= Face_eEffected;
-					}
-				}
+		for (j = 0; j < v->numFaces; j++) {
+			CCGFace *f = v->faces[j];
+			if (!(f->flags & Face_eEffected)) {
+				effectedF[numEffectedF++] = f;
+				f->flags |= Face_eEffected;
 			}
 		}
 	}
 
+	// edges with both vertices in the region go first. Only those have all the
+	// inputs of the level 0 edge passes, the midpoints of the others can't have
+	// changed and are kept from the previous sync
+	numInnerE = 0;
+	for (ptrIdx = 0; ptrIdx < numEffectedE; ptrIdx++) {
+		CCGEdge *e = effectedE[ptrIdx];
+		if (e->v0->flags & e->v1->flags & Vert_eEffected) {
+			effectedE[ptrIdx] = effectedE[numInnerE];
+			effectedE[numInnerE++] = e;
+		}
+	}
+
 	curLvl = 0;
 	nextLvl = curLvl + 1;
+#ifdef _OPENMP
+	numThreads = ccgSubSurf__numThreads(ss, ccgSubSurf__faceCost(effectedF, numEffectedF, nextLvl));
+#endif
 
 	// calculating faces midpoints. Original SDS
+#pragma omp parallel for private(ptrIdx, i) num_threads(numThreads) if (numThreads > 1) schedule(guided)
 	for (ptrIdx = 0; ptrIdx < numEffectedF; ptrIdx++) {
 		CCGFace *f = effectedF[ptrIdx];
 		void *co = FACE_getCenterData(f);
@@ -2315,190 +3895,206 @@ static void ccgSubSurf__sync(CCGSubSurf *ss)
 			VertDataAdd(co, VERT_getCo(FACE_getVerts(f)[i], curLvl), ss);
 		}
 		VertDataMulN(co, 1.0f / f->numVerts, ss);
+	}
 
-		f->flags = 0;
-	}
-
-	//calculating edges midpoints. Original SDS
-	for (ptrIdx = 0; ptrIdx < numEffectedE; ptrIdx++) {
-
-		CCGEdge *e = effectedE[ptrIdx];
-
-		void *co = EDGE_getCo(e, nextLvl, 1);
-
-		//void *co_nexter = EDGE_getCo(e, nextLvl, 0);
-
-		float sharpness = EDGE_getSharpness(e, curLvl);
-
-
-
-		if (_edge_isBoundary(e) || sharpness >= 1.0f) {
-			VertDataCopy(co, VERT_getCo(e->v0, curLvl), ss);
-			VertDataAdd(co, VERT_getCo(e->v1, curLvl), ss);
-			VertDataMulN(co, 0.5f, ss);
-		}
-		else {
-			int numFaces = 0;
-			VertDataCopy(q, VERT_getCo(e->v0, curLvl), ss);
-			VertDataAdd(q, VERT_getCo(e->v1, curLvl), ss);
-			for (i = 0; i < e->numFaces; i++) {
-				CCGFace *f = e->faces[i];
-				VertDataAdd(q, (float *)FACE_getCenterData(f), ss);
-				numFaces++;
-			}
-			VertDataMulN(q, 1.0f / (2.0f + numFaces), ss);
-
-			VertDataCopy(r, VERT_getCo(e->v0, curLvl), ss);
-			VertDataAdd(r, VERT_getCo(e->v1, curLvl), ss);
-			VertDataMulN(r, 0.5f, ss);
+#pragma omp parallel private(ptrIdx, i) num_threads(numThreads) if (numThreads > 1)
+	{
+		float *q, *r;
 
-			VertDataCopy(co, q, ss);
-			VertDataSub(r, q, ss);
-			VertDataMulN(r, sharpness, ss);
-			VertDataAdd(co, r, ss);
+#pragma omp critical
+		{
+			q = MEM_mallocN(ss->meshIFC.vertDataSize, "CCGSubsurf q");
+			r = MEM_mallocN(ss->meshIFC.vertDataSize, "CCGSubsurf r");
 		}
 
-		//VertDataCopy(co_nexter, co, ss);
+		//calculating edges midpoints. Original SDS
+#pragma omp for schedule(guided)
+		for (ptrIdx = 0; ptrIdx < numInnerE; ptrIdx++) {
 
+			CCGEdge *e = effectedE[ptrIdx];
 
+			void *co = EDGE_getCo(e, nextLvl, 1);
 
-		/* edge flags cleared later */
-	}
+			//void *co_nexter = EDGE_getCo(e, nextLvl, 0);
 
-	//calculating new vertices positions. Original SDS
-	for (ptrIdx = 0; ptrIdx < numEffectedV; ptrIdx++) {
-		CCGVert *v = effectedV[ptrIdx];
-		float a[3], b[3], c[3];
-		void *co = VERT_getCo(v, curLvl);
-		void *nCo = VERT_getCo(v, nextLvl);
-		float* nCoCast = (float*)nCo;
-		// lets try to save nCo, then if nCOpreserved == nCo at the end -> reassign
-		int sharpCount = 0, allSharp = 1;
-		float avgSharpness = 0.0;
-		int seam = VERT_seam(v), seamEdges = 0;
-		to_vector(nCo, a);
-
-		for (i = 0; i < v->numEdges; i++) {
-			CCGEdge *e = v->edges[i];
 			float sharpness = EDGE_getSharpness(e, curLvl);
 
-			if (seam && _edge_isBoundary(e))
-				seamEdges++;
 
-			if (sharpness != 0.0f) {
-				sharpCount++;
-				avgSharpness += sharpness;
+
+			if (_edge_isBoundary(e) || sharpness >= 1.0f) {
+				VertDataCopy(co, VERT_getCo(e->v0, curLvl), ss);
+				VertDataAdd(co, VERT_getCo(e->v1, curLvl), ss);
+				VertDataMulN(co, 0.5f, ss);
 			}
 			else {
-				allSharp = 0;
-			}
-		}
+				int numFaces = 0;
+				VertDataCopy(q, VERT_getCo(e->v0, curLvl), ss);
+				VertDataAdd(q, VERT_getCo(e->v1, curLvl), ss);
+				for (i = 0; i < e->numFaces; i++) {
+					CCGFace *f = e->faces[i];
+					VertDataAdd(q, (float *)FACE_getCenterData(f), ss);
+					numFaces++;
+				}
+				VertDataMulN(q, 1.0f / (2.0f + numFaces), ss);
 
-		if (sharpCount) {
-			avgSharpness /= sharpCount;
-			if (avgSharpness > 1.0f) {
-				avgSharpness = 1.0f;
+				VertDataCopy(r, VERT_getCo(e->v0, curLvl), ss);
+				VertDataAdd(r, VERT_getCo(e->v1, curLvl), ss);
+				VertDataMulN(r, 0.5f, ss);
+
+				VertDataCopy(co, q, ss);
+				VertDataSub(r, q, ss);
+				VertDataMulN(r, sharpness, ss);
+				VertDataAdd(co, r, ss);
 			}
-		}
 
-		if (seamEdges < 2 || seamEdges != v->numEdges)
-			seam = 0;
+			//VertDataCopy(co_nexter, co, ss);
+
 
-		if (!v->numEdges || ss->meshIFC.simpleSubdiv) {
-			VertDataCopy(nCo, co, ss);
+
+			/* edge flags cleared later */
 		}
-		else if (_vert_isBoundary(v)) {
-			int numBoundary = 0;
 
-			VertDataZero(r, ss);
+		//calculating new vertices positions. Original SDS
+#pragma omp for schedule(guided)
+		for (ptrIdx = 0; ptrIdx < numEffectedV; ptrIdx++) {
+			CCGVert *v = effectedV[ptrIdx];
+			float a[3], b[3], c[3];
+			void *co = VERT_getCo(v, curLvl);
+			void *nCo = VERT_getCo(v, nextLvl);
+			float* nCoCast = (float*)nCo;
+			// lets try to save nCo, then if nCOpreserved == nCo at the end -> reassign
+			int sharpCount = 0, allSharp = 1;
+			float avgSharpness = 0.0;
+			int seam = VERT_seam(v), seamEdges = 0;
+			to_vector(nCo, a);
+
 			for (i = 0; i < v->numEdges; i++) {
 				CCGEdge *e = v->edges[i];
-				if (_edge_isBoundary(e)) {
-					VertDataAdd(r, VERT_getCo(_edge_getOtherVert(e, v), curLvl), ss);
-					numBoundary++;
+				float sharpness = EDGE_getSharpness(e, curLvl);
+
+				if (seam && _edge_isBoundary(e))
+					seamEdges++;
+
+				if (sharpness != 0.0f) {
+					sharpCount++;
+					avgSharpness += sharpness;
+				}
+				else {
+					allSharp = 0;
 				}
 			}
-			VertDataCopy(nCo, co, ss);
-			VertDataMulN(nCo, 0.75f, ss);
-			VertDataMulN(r, 0.25f / numBoundary, ss);
-			VertDataAdd(nCo, r, ss);
-		}
-		else {
-			int numEdges = 0, numFaces = 0;
 
-			VertDataZero(q, ss);
-			for (i = 0; i < v->numFaces; i++) {
-				CCGFace *f = v->faces[i];
-				VertDataAdd(q, (float *)FACE_getCenterData(f), ss);
-				numFaces++;
+			if (sharpCount) {
+				avgSharpness /= sharpCount;
+				if (avgSharpness > 1.0f) {
+					avgSharpness = 1.0f;
+				}
 			}
-			VertDataMulN(q, 1.0f / numFaces, ss);
-			VertDataZero(r, ss);
-			for (i = 0; i < v->numEdges; i++) {
-				CCGEdge *e = v->edges[i];
-				VertDataAdd(r, VERT_getCo(_edge_getOtherVert(e, v), curLvl), ss);
-				numEdges++;
+
+			if (seamEdges < 2 || seamEdges != v->numEdges)
+				seam = 0;
+
+			if (!v->numEdges || ss->meshIFC.simpleSubdiv) {
+				VertDataCopy(nCo, co, ss);
 			}
-			VertDataMulN(r, 1.0f / numEdges, ss);
+			else if (_vert_isBoundary(v)) {
+				int numBoundary = 0;
 
-			VertDataCopy(nCo, co, ss);
-			VertDataMulN(nCo, numEdges - 2.0f, ss);
-			VertDataAdd(nCo, q, ss);
-			VertDataAdd(nCo, r, ss);
-			VertDataMulN(nCo, 1.0f / numEdges, ss);
-		}
+				VertDataZero(r, ss);
+				for (i = 0; i < v->numEdges; i++) {
+					CCGEdge *e = v->edges[i];
+					if (_edge_isBoundary(e)) {
+						VertDataAdd(r, VERT_getCo(_edge_getOtherVert(e, v), curLvl), ss);
+						numBoundary++;
+					}
+				}
+				VertDataCopy(nCo, co, ss);
+				VertDataMulN(nCo, 0.75f, ss);
+				VertDataMulN(r, 0.25f / numBoundary, ss);
+				VertDataAdd(nCo, r, ss);
+			}
+			else {
+				int numEdges = 0, numFaces = 0;
 
-		if (sharpCount > 1 || seam) {
-			VertDataZero(q, ss);
+				VertDataZero(q, ss);
+				for (i = 0; i < v->numFaces; i++) {
+					CCGFace *f = v->faces[i];
+					VertDataAdd(q, (float *)FACE_getCenterData(f), ss);
+					numFaces++;
+				}
+				VertDataMulN(q, 1.0f / numFaces, ss);
+				VertDataZero(r, ss);
+				for (i = 0; i < v->numEdges; i++) {
+					CCGEdge *e = v->edges[i];
+					VertDataAdd(r, VERT_getCo(_edge_getOtherVert(e, v), curLvl), ss);
+					numEdges++;
+				}
+				VertDataMulN(r, 1.0f / numEdges, ss);
 
-			if (seam) {
-				avgSharpness = 1.0f;
-				sharpCount = seamEdges;
-				allSharp = 1;
+				VertDataCopy(nCo, co, ss);
+				VertDataMulN(nCo, numEdges - 2.0f, ss);
+				VertDataAdd(nCo, q, ss);
+				VertDataAdd(nCo, r, ss);
+				VertDataMulN(nCo, 1.0f / numEdges, ss);
 			}
 
-			for (i = 0; i < v->numEdges; i++) {
-				CCGEdge *e = v->edges[i];
-				float sharpness = EDGE_getSharpness(e, curLvl);
+			if (sharpCount > 1 || seam) {
+				VertDataZero(q, ss);
 
 				if (seam) {
-					if (_edge_isBoundary(e)) {
+					avgSharpness = 1.0f;
+					sharpCount = seamEdges;
+					allSharp = 1;
+				}
+
+				for (i = 0; i < v->numEdges; i++) {
+					CCGEdge *e = v->edges[i];
+					float sharpness = EDGE_getSharpness(e, curLvl);
+
+					if (seam) {
+						if (_edge_isBoundary(e)) {
+							CCGVert *oV = _edge_getOtherVert(e, v);
+							VertDataAdd(q, VERT_getCo(oV, curLvl), ss);
+						}
+					}
+					else if (sharpness != 0.0f) {
 						CCGVert *oV = _edge_getOtherVert(e, v);
 						VertDataAdd(q, VERT_getCo(oV, curLvl), ss);
 					}
 				}
-				else if (sharpness != 0.0f) {
-					CCGVert *oV = _edge_getOtherVert(e, v);
-					VertDataAdd(q, VERT_getCo(oV, curLvl), ss);
-				}
-			}
 
-			VertDataMulN(q, (float) 1 / sharpCount, ss);
+				VertDataMulN(q, (float) 1 / sharpCount, ss);
+
+				if (sharpCount != 2 || allSharp) {
+					/* q = q + (co - q) * avgSharpness */
+					VertDataCopy(r, co, ss);
+					VertDataSub(r, q, ss);
+					VertDataMulN(r, avgSharpness, ss);
+					VertDataAdd(q, r, ss);
+				}
 
-			if (sharpCount != 2 || allSharp) {
-				/* q = q + (co - q) * avgSharpness */
+				/* r = co * 0.75 + q * 0.25 */
 				VertDataCopy(r, co, ss);
-				VertDataSub(r, q, ss);
+				VertDataMulN(r, 0.75f, ss);
+				VertDataMulN(q, 0.25f, ss);
+				VertDataAdd(r, q, ss);
+
+				/* nCo = nCo + (r - nCo) * avgSharpness */
+				VertDataSub(r, nCo, ss);
 				VertDataMulN(r, avgSharpness, ss);
-				VertDataAdd(q, r, ss);
+				VertDataAdd(nCo, r, ss);
 			}
 
-			/* r = co * 0.75 + q * 0.25 */
-			VertDataCopy(r, co, ss);
-			VertDataMulN(r, 0.75f, ss);
-			VertDataMulN(q, 0.25f, ss);
-			VertDataAdd(r, q, ss);
-
-			/* nCo = nCo + (r - nCo) * avgSharpness */
-			VertDataSub(r, nCo, ss);
-			VertDataMulN(r, avgSharpness, ss);
-			VertDataAdd(nCo, r, ss);
+			/* vert flags cleared later */
 		}
 
-		/* vert flags cleared later */
+#pragma omp critical
+		{
+			MEM_freeN(q);
+			MEM_freeN(r);
+		}
 	}
 
-
 	// after we calculated new edges midpoints and new vertices positions we can loop over edges again
 	// getting new midpoints with:              void *co = EDGE_getCo(e, nextLvl, 1);
 	// getting original edge vertices with:     float* myvar =  (float*) VERT_getCo(e->v1, curLvl);
@@ -2506,7 +4102,8 @@ static void ccgSubSurf__sync(CCGSubSurf *ss)
 
 
 	// my edges. 1st pass
-	for (ptrIdx = 0; ptrIdx < numEffectedE; ptrIdx++) {
+#pragma omp parallel for private(ptrIdx) num_threads(numThreads) if (numThreads > 1) schedule(guided)
+	for (ptrIdx = 0; ptrIdx < numInnerE; ptrIdx++) {
 		CCGEdge *e = effectedE[ptrIdx];
 		float* EnCast = (float*)EDGE_getCo(e, nextLvl, 1);
 		// h = En - E0
@@ -2538,11 +4135,13 @@ static void ccgSubSurf__sync(CCGSubSurf *ss)
 		EnCast[2] = cc[2];
 
 	}
-	// put vertices back
+	// put vertices back. This overwrites the level 1 positions read by the 1st pass,
+	// so it runs as its own pass once that one is done. Level 0 is left alone, it
+	// holds the synced coordinates that ccgSubSurf_syncVert compares against
+#pragma omp parallel for private(ptrIdx) num_threads(numThreads) if (numThreads > 1) schedule(guided)
 	for (ptrIdx = 0; ptrIdx < numEffectedV; ptrIdx++) {
 		CCGVert *v = effectedV[ptrIdx];
 		float a[3], b[3], n[3];
-		float* voCast = (float*)VERT_getCo(v, curLvl);
 		float* vnCast = (float*)VERT_getCo(v, nextLvl);
 		to_vector(VERT_getCo(v, curLvl), a);
 		to_vector(VERT_getCo(v, nextLvl), b);
@@ -2552,64 +4151,30 @@ static void ccgSubSurf__sync(CCGSubSurf *ss)
 		vnCast[0] = a[0];
 		vnCast[1] = a[1];
 		vnCast[2] = a[2];
-		voCast[0] = a[0];
-		voCast[1] = a[1];
-		voCast[2] = a[2];
 	}
 
 
-	// mark edges as excluded from second pass processing
-	for (ptrIdx = 0; ptrIdx < numEffectedV; ptrIdx++) {
-		CCGVert *v = effectedV[ptrIdx];
-		int edges_count = v->numEdges;
-		if (v->numEdges==5){
-			// lets flag those edges to prevent altering them later
-			for (i=0; i < v->numEdges; i++){
-				v->edges[i]->flags |= Edge_excluded;
-			}
-		}
-	}
 	// my edges. 2nd pass
+	// every vertex only stores proposals on its own side of its edges, the
+	// midpoints are written by the gather pass below
+#pragma omp parallel for private(ptrIdx, i, j) num_threads(numThreads) if (numThreads > 1) schedule(guided)
 	for (ptrIdx = 0; ptrIdx < numEffectedV; ptrIdx++) {
 		CCGVert *v = effectedV[ptrIdx];
+
+		v->arcEdges = 0;
+
 		// check if vertex has 4 neighbors 
 		if (v->numEdges==4){
 			float v0co[3],v1co[3],v2co[3],v3co[3], P[3];
-			float e0co[3], e1co[3], e2co[3], e3co[3]; 
 			float  res0[3], res1[3];
 
-
-			CCGEdge *e0 = v->edges[0]; 
-			CCGEdge *e1 = v->edges[1];
-			CCGEdge *e2 = v->edges[2];
-			CCGEdge *e3 = v->edges[3];
-
 			CCGVert *v0,*v1,*v2,*v3; 
-			float *en0Cast, *en1Cast, *en2Cast, *en3Cast; 
 
-			// lets sort edges
-			CCGEdge *edges[4] = {e0,e1,e2,e3};
-			CCGEdge *e_temp;
+			// edges in cyclic order, sorted in _vert_calcRing
+			CCGEdge *edges[4];
 
-			for (i = 0; i < 4; i++){
-				for (j =0; j < edges[i]->numFaces; j++){
-					CCGFace *f = edges[i]->faces[j];
-					int k;
-					for (k = 0; k < f->numVerts; k++){
-						if ((i+2 < 4) && (FACE_getEdges(f)[k] == edges[i+2])){
-							e_temp = edges[i+1];
-							edges[i+1] = edges[i+2];
-							edges[i+2] = e_temp;
-						}
-						else if ((i+3 < 4) && (FACE_getEdges(f)[k] == edges[i+3])){
-							e_temp = edges[i+1];
-							edges[i+1] = edges[i+3];
-							edges[i+3] = e_temp;
-						}
-					}
-				}
-			}
-			// edges sorted 
+			for (i = 0; i < 4; i++)
+				edges[i] = _vert_getRingEdge(v, i);
 
 			v0 = _edge_getOtherVert(edges[0], v);
 			v1 = _edge_getOtherVert(edges[1], v);
@@ -2617,11 +4182,6 @@ static void ccgSubSurf__sync(CCGSubSurf *ss)
 			v3 = _edge_getOtherVert(edges[3], v);
 
 
-			en0Cast = (float*)EDGE_getCo(edges[0], nextLvl, 1);
-			en1Cast = (float*)EDGE_getCo(edges[1], nextLvl, 1);
-			en2Cast = (float*)EDGE_getCo(edges[2], nextLvl, 1);
-			en3Cast = (float*)EDGE_getCo(edges[3], nextLvl, 1);
-
 			to_vector(VERT_getCo(v, curLvl), P);
 
 			to_vector(VERT_getCo(v0, curLvl), v0co);
@@ -2629,35 +4189,31 @@ static void ccgSubSurf__sync(CCGSubSurf *ss)
 			to_vector(VERT_getCo(v2, curLvl), v2co);
 			to_vector(VERT_getCo(v3, curLvl), v3co);
 
-			to_vector(EDGE_getCo(edges[0], nextLvl, 1), e0co);
-			to_vector(EDGE_getCo(edges[1], nextLvl, 1), e1co);
-			to_vector(EDGE_getCo(edges[2], nextLvl, 1), e2co);
-			to_vector(EDGE_getCo(edges[3], nextLvl, 1), e3co);
 
 			if ((edges[0]->crease > 0.1 && edges[2]->crease > 0.1) || (edges[1]->crease > 0.1 && edges[3]->crease > 0.1)){
 				if (edges[0]->crease > 0.1 && edges[2]->crease > 0.1) {
 					interp0(v0co,P,v2co,res0);
 					interp0(v2co,P,v0co,res1);
-					set_midpoint(edges[0], res0, e0co, en0Cast);
-					set_midpoint(edges[2], res1, e2co, en2Cast);	
+					set_midpoint(v, edges[0], res0, vertDataSize);
+					set_midpoint(v, edges[2], res1, vertDataSize);	
 				}
 				if (edges[1]->crease > 0.1 && edges[3]->crease > 0.1) {
 					interp0(v1co,P,v3co,res0);
 					interp0(v3co,P,v1co,res1);
-					set_midpoint(edges[1], res0, e1co, en1Cast);
-					set_midpoint(edges[3], res1, e3co, en3Cast);
+					set_midpoint(v, edges[1], res0, vertDataSize);
+					set_midpoint(v, edges[3], res1, vertDataSize);
 				}
 			}
 			else {
 				interp0(v0co,P,v2co,res0);
 				interp0(v2co,P,v0co,res1);
-				set_midpoint(edges[0], res0, e0co, en0Cast);
-				set_midpoint(edges[2], res1, e2co, en2Cast);
+				set_midpoint(v, edges[0], res0, vertDataSize);
+				set_midpoint(v, edges[2], res1, vertDataSize);
 
 				interp0(v1co,P,v3co,res0);
 				interp0(v3co,P,v1co,res1);
-				set_midpoint(edges[1], res0, e1co, en1Cast);
-				set_midpoint(edges[3], res1, e3co, en3Cast);
+				set_midpoint(v, edges[1], res0, vertDataSize);
+				set_midpoint(v, edges[3], res1, vertDataSize);
 			}
 			
 		}
@@ -2668,7 +4224,6 @@ static void ccgSubSurf__sync(CCGSubSurf *ss)
 			float bd[3], bP[3], db[3], dP[3];
 			float s[3], ha[3], hc[3];
 			float projection, ha_sq, hc_sq, s_sq, ra, rc;
-			float e0co[3], e1co[3], e2co[3], e3co[3], e4co[3], en0[3], en1[3], en2[3], en3[3]; 
 			float dir0[3], dir1[3], dir2[3], dir3[3];
 			float res[3], sagitta[3], res0[3], res1[3];
 			float halfchord_sq, cos_sq, aP_sq, cP_sq, x;
@@ -2681,7 +4236,6 @@ static void ccgSubSurf__sync(CCGSubSurf *ss)
 			CCGEdge *e4 = v->edges[4];
 
 			CCGVert *v0,*v1,*v2,*v3,*v4; 
-			float *en0Cast, *en1Cast, *en2Cast, *en3Cast, *en4Cast; 
 
 			// lets sort edges
 			CCGEdge *edges[5] = {e0,e1,e2,e3,e4};
@@ -2719,12 +4273,6 @@ static void ccgSubSurf__sync(CCGSubSurf *ss)
 			v4 = _edge_getOtherVert(edges[4], v);
 
 
-			en0Cast = (float*)EDGE_getCo(edges[0], nextLvl, 1);
-			en1Cast = (float*)EDGE_getCo(edges[1], nextLvl, 1);
-			en2Cast = (float*)EDGE_getCo(edges[2], nextLvl, 1);
-			en3Cast = (float*)EDGE_getCo(edges[3], nextLvl, 1);
-			en4Cast = (float*)EDGE_getCo(edges[4], nextLvl, 1);
-
 			to_vector(VERT_getCo(v, curLvl), P);
 
 			to_vector(VERT_getCo(v0, curLvl), v0co);
@@ -2733,102 +4281,48 @@ static void ccgSubSurf__sync(CCGSubSurf *ss)
 			to_vector(VERT_getCo(v3, curLvl), v3co);
 			to_vector(VERT_getCo(v4, curLvl), v4co);
 
-			to_vector(EDGE_getCo(edges[0], nextLvl, 1), e0co);
-			to_vector(EDGE_getCo(edges[1], nextLvl, 1), e1co);
-			to_vector(EDGE_getCo(edges[2], nextLvl, 1), e2co);
-			to_vector(EDGE_getCo(edges[3], nextLvl, 1), e3co);
-			to_vector(EDGE_getCo(edges[4], nextLvl, 1), e4co);
 
 			//[v0, V, v2], [v0, V, v3], [v1, V, v3], [v1, V, v4], [v2, V, v4]
 			//[v0, V, v2], [v1, V, v3], [v2, V, v4]
 
 			interp0(v0co,P,v2co,res0);
 			interp0(v2co,P,v0co,res1);
-			set_midpoint(edges[0], res0, e0co, en0Cast);
-			set_midpoint(edges[2], res1, e2co, en2Cast);
+			set_midpoint(v, edges[0], res0, vertDataSize);
+			set_midpoint(v, edges[2], res1, vertDataSize);
 
 			interp0(v1co,P,v3co,res0);
 			interp0(v3co,P,v1co,res1);
-			set_midpoint(edges[1], res0, e1co, en1Cast);
-			set_midpoint(edges[3], res1, e3co, en3Cast);
+			set_midpoint(v, edges[1], res0, vertDataSize);
+			set_midpoint(v, edges[3], res1, vertDataSize);
 
 
 			interp0(v2co,P,v4co,res0);
 			interp0(v4co,P,v2co,res1);
-			set_midpoint(edges[4], res1, e4co, en4Cast);
+			set_midpoint(v, edges[4], res1, vertDataSize);
 
 		}
 
 		if (v->numEdges==3){
-			float v0co[3],v1co[3],v2co[3],v3co[3], P[3];
+			float v0co[3],v1co[3],v2co[3], P[3];
 			float vop1co[3], vop2co[3];
-			float e0co[3], e1co[3], e2co[3], e3co[3]; 
 			float  res0[3], res1[3];
-			int is_e0=0;
-			int is_e1=0;
-			int is_e2=0;
-
-			CCGEdge *e0 = v->edges[0]; 
-			CCGEdge *e1 = v->edges[1];
-			CCGEdge *e2 = v->edges[2];
 
 			CCGVert *v0,*v1,*v2; 
-			CCGVert *v_opposite1, *v_opposite2; 
-			float *en0Cast, *en1Cast, *en2Cast; 
+			CCGVert *v_opposite1; 
 			CCGEdge *edges[3];
-			CCGFace *f5;
 
-			if (e0->numFaces == 2){
-				for (i =0; i < e0->numFaces; i++){
-					if (e0->faces[i]->numVerts == 5) {is_e0 = 1; f5 = e0->faces[i];}
-				}
-			}
-			if (e1->numFaces == 2){
-				for (i =0; i < e1->numFaces; i++){
-					if (e1->faces[i]->numVerts == 5) {is_e1 = 1; f5 = e1->faces[i];}
-				}
-			}
-			if (e2->numFaces == 2){
-				for (i =0; i < e2->numFaces; i++){
-					if (e2->faces[i]->numVerts == 5) {is_e2 = 1; f5 = e2->faces[i];}
-				}
-			}
-			// we check if only two edges are in 5-sided face
-			if (is_e0 + is_e1 + is_e2 == 2) {
-				if (is_e0 && is_e1) {
-					edges[0] = e0; 
-					edges[1] = e1;
-					edges[2] = e2;
-				}
-				if (is_e0 && is_e2) {
-					edges[0] = e0; 
-					edges[1] = e2;
-					edges[2] = e1;
-				}
-				if (is_e1 && is_e2) {
-					edges[0] = e1; 
-					edges[1] = e2;
-					edges[2] = e0;
-				}
+			// only when two edges are in a 5-sided face, see _vert_calcRing
+			if (v->ring & VertRing_eArc) {
+				for (i = 0; i < 3; i++)
+					edges[i] = _vert_getRingEdge(v, i);
 
-				// find two opposite vertices to align tangent of the dead-end spline 
-				for (i = 0; i < 5; i++){
-					if (FACE_getVerts(f5)[i] == v){
-						if (i+2 > 4) {v_opposite1 = FACE_getVerts(f5)[i-3];}
-						else {v_opposite1 = FACE_getVerts(f5)[i+2];}
-						if (i-2 < 0) {v_opposite2 = FACE_getVerts(f5)[i+3];}
-						else {v_opposite2 = FACE_getVerts(f5)[i-2];}
-						break;
-					}
-				}
+				// opposite vertex to align tangent of the dead-end spline
+				v_opposite1 = _vert_getRingOpposite(v);
 
 				v0 = _edge_getOtherVert(edges[0], v);
 				v1 = _edge_getOtherVert(edges[1], v);
 				v2 = _edge_getOtherVert(edges[2], v);
 
-				en0Cast = (float*)EDGE_getCo(edges[0], nextLvl, 1);
-				en1Cast = (float*)EDGE_getCo(edges[1], nextLvl, 1);
-				en2Cast = (float*)EDGE_getCo(edges[2], nextLvl, 1);
 
 				to_vector(VERT_getCo(v, curLvl), P);
 
@@ -2841,18 +4335,15 @@ static void ccgSubSurf__sync(CCGSubSurf *ss)
 				to_vector(VERT_getCo(v1, curLvl), v1co);
 				to_vector(VERT_getCo(v2, curLvl), v2co);
 
-				to_vector(EDGE_getCo(edges[0], nextLvl, 1), e0co);
-				to_vector(EDGE_getCo(edges[1], nextLvl, 1), e1co);
-				to_vector(EDGE_getCo(edges[2], nextLvl, 1), e2co);
 
 
 				interp0(v0co,P,v1co,res0);
 				interp0(v1co,P,v0co,res1);
-				set_midpoint(edges[0], res0, e0co, en0Cast);
-				set_midpoint(edges[1], res1, e1co, en1Cast);
+				set_midpoint(v, edges[0], res0, vertDataSize);
+				set_midpoint(v, edges[1], res1, vertDataSize);
 
 				interp0(v2co,P,vop1co,res0);
-				set_midpoint(edges[2], res0, e2co, en2Cast);
+				set_midpoint(v, edges[2], res0, vertDataSize);
 
 
 			}
@@ -2861,8 +4352,20 @@ static void ccgSubSurf__sync(CCGSubSurf *ss)
 		}
 	}
 
+	// gather the arc midpoints proposed by both end vertices. Edges of 5-valent
+	// vertices are excluded and keep the result of the 1st pass
+#pragma omp parallel for private(ptrIdx) num_threads(numThreads) if (numThreads > 1) schedule(guided)
+	for (ptrIdx = 0; ptrIdx < numInnerE; ptrIdx++) {
+		CCGEdge *e = effectedE[ptrIdx];
+
+		if (e->v0->numEdges != 5 && e->v1->numEdges != 5) {
+			gather_midpoint(e, (float *)EDGE_getCo(e, nextLvl, 1), vertDataSize);
+		}
+	}
+
 
 	// Faces midpoints. My alteration
+#pragma omp parallel for private(ptrIdx) num_threads(numThreads) if (numThreads > 1) schedule(guided)
 	for (ptrIdx = 0; ptrIdx < numEffectedF; ptrIdx++) {
 		CCGFace *f = effectedF[ptrIdx];
 		if (f->numVerts == 4){
@@ -3090,11 +4593,13 @@ static void ccgSubSurf__sync(CCGSubSurf *ss)
 		}
 	}
 
+#pragma omp parallel for private(i) num_threads(numThreads) if (numThreads > 1) schedule(guided)
 	for (i = 0; i < numEffectedE; i++) {
 		CCGEdge *e = effectedE[i];
 		VertDataCopy(EDGE_getCo(e, nextLvl, 0), VERT_getCo(e->v0, nextLvl), ss);
 		VertDataCopy(EDGE_getCo(e, nextLvl, 2), VERT_getCo(e->v1, nextLvl), ss);
 	}
+#pragma omp parallel for private(i, S) num_threads(numThreads) if (numThreads > 1) schedule(guided)
 	for (i = 0; i < numEffectedF; i++) {
 		CCGFace *f = effectedF[i];
 		for (S = 0; S < f->numVerts; S++) {
@@ -3111,29 +4616,271 @@ static void ccgSubSurf__sync(CCGSubSurf *ss)
 		}
 	}
 
-	for (curLvl = 1; curLvl < subdivLevels; curLvl++) {
-		ccgSubSurf__calcSubdivLevel(ss,
-		                            effectedV, effectedE, effectedF,
-		                            numEffectedV, numEffectedE, numEffectedF, curLvl);
+	// the face normals go with the last level when they are wanted for
+	// the same elements
+	fuseNormals = ss->calcVertNormals && !deferNormals && !ss->pendingNormals && subdivLevels > 1;
+	ccgSubSurf__calcSubdivLevels(ss,
+	                             effectedV, effectedE, effectedF,
+	                             numEffectedV, numEffectedE, numEffectedF, 1, subdivLevels, fuseNormals);
+
+	// the elements the last syncs left without their normals keep their
+	// levels and get the normals with the ones changed now
+	if (ss->pendingNormals) {
+		ccgSubSurf__addPending(ss, effectedV, effectedE, effectedF,
+		                       &numEffectedV, &numEffectedE, &numEffectedF);
 	}
 
-	if (ss->calcVertNormals)
+	if (fuseNormals)
+		ccgSubSurf__stitchNormals(ss, effectedV, effectedE, numEffectedV, numEffectedE, subdivLevels);
+	else if (ss->calcVertNormals && !deferNormals)
 		ccgSubSurf__calcVertNormals(ss,
 		                            effectedV, effectedE, effectedF,
 		                            numEffectedV, numEffectedE, numEffectedF);
 
 	for (ptrIdx = 0; ptrIdx < numEffectedV; ptrIdx++) {
 		CCGVert *v = effectedV[ptrIdx];
-		v->flags = 0;
+		v->flags &= Vert_eSeam;
 	}
 	for (ptrIdx = 0; ptrIdx < numEffectedE; ptrIdx++) {
 		CCGEdge *e = effectedE[ptrIdx];
 		e->flags = 0;
 	}
+	for (ptrIdx = 0; ptrIdx < numEffectedF; ptrIdx++) {
+		CCGFace *f = effectedF[ptrIdx];
+		f->flags = 0;
+	}
 
-	MEM_freeN(effectedF);
-	MEM_freeN(effectedE);
-	MEM_freeN(effectedV);
+	if (deferNormals) {
+		/* the effected elements are the ones missing the normals now */
+		ss->pendingNormals = 1;
+		ss->pendingV = effectedV;
+		ss->pendingE = effectedE;
+		ss->pendingF = effectedF;
+		ss->numPendingV = numEffectedV;
+		ss->numPendingE = numEffectedE;
+		ss->numPendingF = numEffectedF;
+	}
+	else {
+		MEM_freeN(effectedF);
+		MEM_freeN(effectedE);
+		MEM_freeN(effectedV);
+	}
+
+	ccgSubSurf__endEval(ss);
+}
+
+/* ccgSubSurf__changeLevels leaves the new address of a moved element in the
+ * key of the old one */
+BLI_INLINE void *_elem_moved(void *elem)
+{
+	return ((EHEntry *) elem)->key;
+}
+
+/* Move the elements to storage for subdivLevels, keeping the levels the old
+ * and the new count have in common and the topology as it is. Only the
+ * levels above those are calculated, and the normals of the finest level.
+ * The face grids are moved level by level since the finest level has its
+ * own place in the face, see _face_getGridBase. */
+static void ccgSubSurf__changeLevels(CCGSubSurf *ss, int subdivLevels)
+{
+	int oldLevels = ss->subdivLevels;
+	int minLevels = MIN2(oldLevels, subdivLevels);
+	int vertDataSize = ss->meshIFC.vertDataSize;
+	int numVerts = ss->vMap->numEntries, numEdges = ss->eMap->numEntries, numFaces = ss->fMap->numEntries;
+	int oldGridSize = ccg_gridsize(oldLevels);
+	int i, j, lvl, baseLvl = minLevels, fuseNormals = 0;
+	CCGElemPool vertPool, edgePool, facePool;
+	CCGVert **verts;
+	CCGEdge **edges;
+	CCGFace **faces;
+	byte *vertMem, *edgeMem, *faceMem;
+	size_t vertStep, edgeStep, faceBytes = 0;
+
+	ccgSubSurf__beginEval(ss);
+	ss->subdivLevels = subdivLevels;
+	ccgSubSurf__dropPending(ss);
+
+	vertStep = _elem_alignSize(_vert_size(ss));
+	edgeStep = _elem_alignSize(_edge_size(ss));
+	for (i = 0; i < numFaces; i++) {
+		CCGFace *f = (CCGFace *) ss->fMap->entries[i].entry;
+		faceBytes += _elem_alignSize(_face_size(ss, f->numVerts));
+	}
+
+	memset(&vertPool, 0, sizeof(vertPool));
+	memset(&edgePool, 0, sizeof(edgePool));
+	memset(&facePool, 0, sizeof(facePool));
+	vertMem = _elem_allocPool(&vertPool, vertStep * numVerts, numVerts);
+	edgeMem = _elem_allocPool(&edgePool, edgeStep * numEdges, numEdges);
+	faceMem = _elem_allocPool(&facePool, faceBytes, numFaces);
+
+	verts = MEM_mallocN(sizeof(*verts) * MAX2(numVerts, 1), "CCGSubsurf verts");
+	edges = MEM_mallocN(sizeof(*edges) * MAX2(numEdges, 1), "CCGSubsurf edges");
+	faces = MEM_mallocN(sizeof(*faces) * MAX2(numFaces, 1), "CCGSubsurf faces");
+
+	/* copy every element and leave its new address in the old one, the
+	 * references between them are fixed up below */
+	for (i = 0; i < numVerts; i++) {
+		CCGVert *v = verts[i] = (CCGVert *) ss->vMap->entries[i].entry;
+		CCGVert *nv = (CCGVert *) (vertMem + vertStep * i);
+
+		memcpy(nv, v, sizeof(CCGVert) + vertDataSize * (minLevels + 1));
+		memcpy(ccgSubSurf_getVertUserData(ss, nv), VERT_getLevelData(v) + vertDataSize * (oldLevels + 1),
+		       ss->meshIFC.vertUserSize);
+		ss->vMap->entries[i].entry = (EHEntry *) nv;
+		((EHEntry *) v)->key = nv;
+	}
+	for (i = 0; i < numEdges; i++) {
+		CCGEdge *e = edges[i] = (CCGEdge *) ss->eMap->entries[i].entry;
+		CCGEdge *ne = (CCGEdge *) (edgeMem + edgeStep * i);
+
+		memcpy(ne, e, sizeof(CCGEdge) + vertDataSize * ccg_edgebase(minLevels + 1));
+		memcpy(ccgSubSurf_getEdgeUserData(ss, ne), EDGE_getLevelData(e) + vertDataSize * ccg_edgebase(oldLevels + 1),
+		       ss->meshIFC.edgeUserSize);
+		ss->eMap->entries[i].entry = (EHEntry *) ne;
+		((EHEntry *) e)->key = ne;
+	}
+	for (i = 0; i < numFaces; i++) {
+		CCGFace *f = faces[i] = (CCGFace *) ss->fMap->entries[i].entry;
+		CCGFace *nf = (CCGFace *) faceMem;
+		byte *userData = FACE_getCenterData(f) + vertDataSize * (1 + f->numVerts * (oldGridSize + oldGridSize * oldGridSize +
+		                                                                            ccg_gridbase(oldLevels)));
+
+		/* header, corners and the center */
+		memcpy(nf, f, FACE_getCenterData(f) + vertDataSize - (byte *) f);
+		for (lvl = 1; lvl <= minLevels; lvl++) {
+			int gridSize = ccg_gridsize(lvl);
+
+			memcpy(_face_getGridBase(nf, lvl, 0, subdivLevels, vertDataSize),
+			       _face_getGridBase(f, lvl, 0, oldLevels, vertDataSize),
+			       vertDataSize * f->numVerts * (gridSize + gridSize * gridSize));
+		}
+		/* the center holds the finest level, the grids have a copy of it */
+		if (baseLvl < oldLevels) {
+			VertDataCopy((float *) FACE_getCenterData(nf),
+			             _face_getIFCo(f, baseLvl, 0, 0, 0, oldLevels, vertDataSize), ss);
+		}
+
+		memcpy(ccgSubSurf_getFaceUserData(ss, nf), userData, ss->meshIFC.faceUserSize);
+
+		ss->fMap->entries[i].entry = (EHEntry *) nf;
+		((EHEntry *) f)->key = nf;
+		faceMem += _elem_alignSize(_face_size(ss, f->numVerts));
+	}
+
+	/* the adjacency arrays are shared by the old and the new elements */
+	for (i = 0; i < numVerts; i++) {
+		CCGVert *v = (CCGVert *) ss->vMap->entries[i].entry;
+
+		for (j = 0; j < v->numEdges; j++)
+			v->edges[j] = _elem_moved(v->edges[j]);
+		for (j = 0; j < v->numFaces; j++)
+			v->faces[j] = _elem_moved(v->faces[j]);
+	}
+	for (i = 0; i < numEdges; i++) {
+		CCGEdge *e = (CCGEdge *) ss->eMap->entries[i].entry;
+
+		e->v0 = _elem_moved(e->v0);
+		e->v1 = _elem_moved(e->v1);
+		for (j = 0; j < e->numFaces; j++)
+			e->faces[j] = _elem_moved(e->faces[j]);
+	}
+	for (i = 0; i < numFaces; i++) {
+		CCGFace *f = (CCGFace *) ss->fMap->entries[i].entry;
+
+		for (j = 0; j < f->numVerts; j++) {
+			FACE_getVerts(f)[j] = _elem_moved(FACE_getVerts(f)[j]);
+			FACE_getEdges(f)[j] = _elem_moved(FACE_getEdges(f)[j]);
+		}
+	}
+
+	/* the adjacency arrays went over to the new elements, only free the old
+	 * elements themselves */
+	for (i = 0; i < numVerts; i++) {
+		_elem_free(ss, &ss->vertPool, verts[i]);
+		verts[i] = (CCGVert *) ss->vMap->entries[i].entry;
+		verts[i]->flags |= Vert_eEffected;
+	}
+	for (i = 0; i < numEdges; i++) {
+		_elem_free(ss, &ss->edgePool, edges[i]);
+		edges[i] = (CCGEdge *) ss->eMap->entries[i].entry;
+		edges[i]->flags = Edge_eEffected;
+	}
+	for (i = 0; i < numFaces; i++) {
+		_elem_free(ss, &ss->facePool, faces[i]);
+		faces[i] = (CCGFace *) ss->fMap->entries[i].entry;
+		faces[i]->flags = Face_eEffected;
+	}
+	ss->vertPool = vertPool;
+	ss->edgePool = edgePool;
+	ss->facePool = facePool;
+
+	if (baseLvl < subdivLevels) {
+		fuseNormals = ss->calcVertNormals && !ss->lazyNormals;
+		ccgSubSurf__calcSubdivLevels(ss, verts, edges, faces, numVerts, numEdges, numFaces, baseLvl, subdivLevels,
+		                             fuseNormals);
+	}
+
+	/* with lazy normals all elements are pending */
+	ss->pendingNormals = ss->calcVertNormals && ss->lazyNormals;
+	if (ss->calcVertNormals && !ss->lazyNormals) {
+		if (fuseNormals)
+			ccgSubSurf__stitchNormals(ss, verts, edges, numVerts, numEdges, subdivLevels);
+		else
+			ccgSubSurf__calcVertNormals(ss, verts, edges, faces, numVerts, numEdges, numFaces);
+	}
+
+	for (i = 0; i < numVerts; i++)
+		verts[i]->flags &= Vert_eSeam;
+	for (i = 0; i < numEdges; i++)
+		edges[i]->flags = 0;
+	for (i = 0; i < numFaces; i++)
+		faces[i]->flags = 0;
+
+	MEM_freeN(faces);
+	MEM_freeN(edges);
+	MEM_freeN(verts);
+	ccgSubSurf__endEval(ss);
+}
+
+/* Calculate the normals of the elements that the syncs left without them,
+ * their levels are all there. */
+static void ccgSubSurf__evalNormals(CCGSubSurf *ss)
+{
+	CCGVert **verts;
+	CCGEdge **edges;
+	CCGFace **faces;
+	int numVerts, numEdges, numFaces, i;
+
+	ccgSubSurf__beginEval(ss);
+	ccgSubSurf__listPending(ss);
+	verts = ss->pendingV;
+	edges = ss->pendingE;
+	faces = ss->pendingF;
+	numVerts = ss->numPendingV;
+	numEdges = ss->numPendingE;
+	numFaces = ss->numPendingF;
+
+	for (i = 0; i < numVerts; i++)
+		verts[i]->flags |= Vert_eEffected;
+	for (i = 0; i < numEdges; i++)
+		edges[i]->flags |= Edge_eEffected;
+	for (i = 0; i < numFaces; i++)
+		faces[i]->flags |= Face_eEffected;
+
+	if (ss->calcVertNormals)
+		ccgSubSurf__calcVertNormals(ss, verts, edges, faces, numVerts, numEdges, numFaces);
+
+	for (i = 0; i < numVerts; i++)
+		verts[i]->flags &= Vert_eSeam;
+	for (i = 0; i < numEdges; i++)
+		edges[i]->flags = 0;
+	for (i = 0; i < numFaces; i++)
+		faces[i]->flags = 0;
+
+	ss->pendingNormals = 0;
+	ccgSubSurf__dropPending(ss);
+	ccgSubSurf__endEval(ss);
 }
 
 static void ccgSubSurf__allFaces(CCGSubSurf *ss, CCGFace ***faces, int *numFaces, int *freeFaces)
@@ -3144,11 +4891,10 @@ static void ccgSubSurf__allFaces(CCGSubSurf *ss, CCGFace ***faces, int *numFaces
 	if (*faces == NULL) {
 		array = MEM_mallocN(sizeof(*array) * ss->fMap->numEntries, "CCGSubsurf allFaces");
 		num = 0;
-		for (i = 0; i < ss->fMap->curSize; i++) {
-			CCGFace *f = (CCGFace *) ss->fMap->buckets[i];
+		for (i = 0; i < ss->fMap->numEntries; i++) {
+			CCGFace *f = (CCGFace *) ss->fMap->entries[i].entry;
 
-			for (; f; f = f->next)
-				array[num++] = f;
+			array[num++] = f;
 		}
 
 		*faces = array;
@@ -3175,33 +4921,29 @@ static void ccgSubSurf__effectedFaceNeighbours(CCGSubSurf *ss, CCGFace **faces,
 		f->flags |= Face_eEffected;
 	}
 
-	for (i = 0; i < ss->vMap->curSize; i++) {
-		CCGVert *v = (CCGVert *) ss->vMap->buckets[i];
+	for (i = 0; i < ss->vMap->numEntries; i++) {
+		CCGVert *v = (CCGVert *) ss->vMap->entries[i].entry;
 
-		for (; v; v = v->next) {
-			for (j = 0; j < v->numFaces; j++)
-				if (!(v->faces[j]->flags & Face_eEffected))
-					break;
-			
-			if (j == v->numFaces) {
-				arrayV[numV++] = v;
-				v->flags |= Vert_eEffected;
-			}
+		for (j = 0; j < v->numFaces; j++)
+			if (!(v->faces[j]->flags & Face_eEffected))
+				break;
+		
+		if (j == v->numFaces) {
+			arrayV[numV++] = v;
+			v->flags |= Vert_eEffected;
 		}
 	}
 
-	for (i = 0; i < ss->eMap->curSize; i++) {
-		CCGEdge *e = (CCGEdge *) ss->eMap->buckets[i];
+	for (i = 0; i < ss->eMap->numEntries; i++) {
+		CCGEdge *e = (CCGEdge *) ss->eMap->entries[i].entry;
 
-		for (; e; e = e->next) {
-			for (j = 0; j < e->numFaces; j++)
-				if (!(e->faces[j]->flags & Face_eEffected))
-					break;
-			
-			if (j == e->numFaces) {
-				e->flags |= Edge_eEffected;
-				arrayE[numE++] = e;
-			}
+		for (j = 0; j < e->numFaces; j++)
+			if (!(e->faces[j]->flags & Face_eEffected))
+				break;
+		
+		if (j == e->numFaces) {
+			e->flags |= Edge_eEffected;
+			arrayE[numE++] = e;
 		}
 	}
 
@@ -3211,18 +4953,60 @@ static void ccgSubSurf__effectedFaceNeighbours(CCGSubSurf *ss, CCGFace **faces,
 	*numEdges = numE;
 }
 
+/* The functions below address a coarse level of the face grids as every
+ * spacing'th sample of the finest grid, which is what multires fills in.
+ * Copy between those samples and the separate storage of the level. */
+static void ccgSubSurf__syncGridLevel(CCGSubSurf *ss, int lvl, CCGFace **effectedF, int numEffectedF, int toFinest)
+{
+	int i, S, x, y, subdivLevels = ss->subdivLevels;
+	int vertDataSize = ss->meshIFC.vertDataSize;
+	int gridSize = ccg_gridsize(lvl);
+	int spacing;
+
+	if (lvl == subdivLevels)
+		return;
+
+	spacing = ccg_spacing(subdivLevels, lvl);
+
+	for (i = 0; i < numEffectedF; i++) {
+		CCGFace *f = effectedF[i];
+
+		for (S = 0; S < f->numVerts; S++) {
+			for (x = 0; x < gridSize; x++) {
+				byte *co = _face_getIECo(f, lvl, S, x, subdivLevels, vertDataSize);
+				byte *fineCo = _face_getIECo(f, subdivLevels, S, x * spacing, subdivLevels, vertDataSize);
+
+				if (toFinest) memcpy(fineCo, co, vertDataSize);
+				else memcpy(co, fineCo, vertDataSize);
+			}
+
+			for (y = 0; y < gridSize; y++) {
+				for (x = 0; x < gridSize; x++) {
+					byte *co = _face_getIFCo(f, lvl, S, x, y, subdivLevels, vertDataSize);
+					byte *fineCo = _face_getIFCo(f, subdivLevels, S, x * spacing, y * spacing, subdivLevels, vertDataSize);
+
+					if (toFinest) memcpy(fineCo, co, vertDataSize);
+					else memcpy(co, fineCo, vertDataSize);
+				}
+			}
+		}
+	}
+}
+
 /* copy face grid coordinates to other places */
 CCGError ccgSubSurf_updateFromFaces(CCGSubSurf *ss, int lvl, CCGFace **effectedF, int numEffectedF)
 {
 	int i, S, x, gridSize, cornerIdx, subdivLevels;
 	int vertDataSize = ss->meshIFC.vertDataSize, freeF;
 
+	ccgSubSurf__needNormals(ss);
 	subdivLevels = ss->subdivLevels;
 	lvl = (lvl) ? lvl : subdivLevels;
 	gridSize = ccg_gridsize(lvl);
 	cornerIdx = gridSize - 1;
 
 	ccgSubSurf__allFaces(ss, &effectedF, &numEffectedF, &freeF);
+	ccgSubSurf__syncGridLevel(ss, lvl, effectedF, numEffectedF, 0);
 
 	for (i = 0; i < numEffectedF; i++) {
 		CCGFace *f = effectedF[i];
@@ -3245,6 +5029,8 @@ CCGError ccgSubSurf_updateFromFaces(CCGSubSurf *ss, int lvl, CCGFace **effectedF
 		}
 	}
 
+	ccgSubSurf__syncGridLevel(ss, lvl, effectedF, numEffectedF, 1);
+
 	if (freeF) MEM_freeN(effectedF);
 
 	return eCCGError_None;
@@ -3256,12 +5042,14 @@ CCGError ccgSubSurf_updateToFaces(CCGSubSurf *ss, int lvl, CCGFace **effectedF,
 	int i, S, x, gridSize, cornerIdx, subdivLevels;
 	int vertDataSize = ss->meshIFC.vertDataSize, freeF;
 
+	ccgSubSurf__needNormals(ss);
 	subdivLevels = ss->subdivLevels;
 	lvl = (lvl) ? lvl : subdivLevels;
 	gridSize = ccg_gridsize(lvl);
 	cornerIdx = gridSize - 1;
 
 	ccgSubSurf__allFaces(ss, &effectedF, &numEffectedF, &freeF);
+	ccgSubSurf__syncGridLevel(ss, lvl, effectedF, numEffectedF, 0);
 
 	for (i = 0; i < numEffectedF; i++) {
 		CCGFace *f = effectedF[i];
@@ -3287,6 +5075,8 @@ CCGError ccgSubSurf_updateToFaces(CCGSubSurf *ss, int lvl, CCGFace **effectedF,
 		}
 	}
 
+	ccgSubSurf__syncGridLevel(ss, lvl, effectedF, numEffectedF, 1);
+
 	if (freeF) MEM_freeN(effectedF);
 
 	return eCCGError_None;
@@ -3302,6 +5092,7 @@ CCGError ccgSubSurf_stitchFaces(CCGSubSurf *ss, int lvl, CCGFace **effectedF, in
 	int i, S, x, gridSize, cornerIdx, subdivLevels, edgeSize;
 	int vertDataSize = ss->meshIFC.vertDataSize;
 
+	ccgSubSurf__needNormals(ss);
 	subdivLevels = ss->subdivLevels;
 	lvl = (lvl) ? lvl : subdivLevels;
 	gridSize = ccg_gridsize(lvl);
@@ -3309,6 +5100,7 @@ CCGError ccgSubSurf_stitchFaces(CCGSubSurf *ss, int lvl, CCGFace **effectedF, in
 	cornerIdx = gridSize - 1;
 
 	ccgSubSurf__allFaces(ss, &effectedF, &numEffectedF, &freeF);
+	ccgSubSurf__syncGridLevel(ss, lvl, effectedF, numEffectedF, 0);
 	ccgSubSurf__effectedFaceNeighbours(ss, effectedF, numEffectedF,
 	                                   &effectedV, &numEffectedV, &effectedE, &numEffectedE);
 
@@ -3415,8 +5207,10 @@ CCGError ccgSubSurf_stitchFaces(CCGSubSurf *ss, int lvl, CCGFace **effectedF, in
 		}
 	}
 
+	ccgSubSurf__syncGridLevel(ss, lvl, effectedF, numEffectedF, 1);
+
 	for (i = 0; i < numEffectedV; i++)
-		effectedV[i]->flags = 0;
+		effectedV[i]->flags &= Vert_eSeam;
 	for (i = 0; i < numEffectedE; i++)
 		effectedE[i]->flags = 0;
 	for (i = 0; i < numEffectedF; i++)
@@ -3436,6 +5230,8 @@ CCGError ccgSubSurf_updateNormals(CCGSubSurf *ss, CCGFace **effectedF, int numEf
 	CCGEdge **effectedE;
 	int i, numEffectedV, numEffectedE, freeF;
 
+	ccgSubSurf__needNormals(ss);
+	ccgSubSurf__beginEval(ss);
 	ccgSubSurf__allFaces(ss, &effectedF, &numEffectedF, &freeF);
 	ccgSubSurf__effectedFaceNeighbours(ss, effectedF, numEffectedF,
 	                                   &effectedV, &numEffectedV, &effectedE, &numEffectedE);
@@ -3446,7 +5242,7 @@ CCGError ccgSubSurf_updateNormals(CCGSubSurf *ss, CCGFace **effectedF, int numEf
 		                            numEffectedV, numEffectedE, numEffectedF);
 
 	for (i = 0; i < numEffectedV; i++)
-		effectedV[i]->flags = 0;
+		effectedV[i]->flags &= Vert_eSeam;
 	for (i = 0; i < numEffectedE; i++)
 		effectedE[i]->flags = 0;
 	for (i = 0; i < numEffectedF; i++)
@@ -3456,6 +5252,8 @@ CCGError ccgSubSurf_updateNormals(CCGSubSurf *ss, CCGFace **effectedF, int numEf
 	MEM_freeN(effectedV);
 	if (freeF) MEM_freeN(effectedF);
 
+	ccgSubSurf__endEval(ss);
+
 	return eCCGError_None;
 }
 
@@ -3467,20 +5265,20 @@ CCGError ccgSubSurf_updateLevels(CCGSubSurf *ss, int lvl, CCGFace **effectedF, i
 	CCGVert **effectedV;
 	CCGEdge **effectedE;
 	int numEffectedV, numEffectedE, freeF, i;
-	int curLvl, subdivLevels = ss->subdivLevels;
 
+	ccgSubSurf__needNormals(ss);
+	ccgSubSurf__beginEval(ss);
 	ccgSubSurf__allFaces(ss, &effectedF, &numEffectedF, &freeF);
+	ccgSubSurf__syncGridLevel(ss, lvl, effectedF, numEffectedF, 0);
 	ccgSubSurf__effectedFaceNeighbours(ss, effectedF, numEffectedF,
 	                                   &effectedV, &numEffectedV, &effectedE, &numEffectedE);
 
-	for (curLvl = lvl; curLvl < subdivLevels; curLvl++) {
-		ccgSubSurf__calcSubdivLevel(ss,
-		                            effectedV, effectedE, effectedF,
-		                            numEffectedV, numEffectedE, numEffectedF, curLvl);
-	}
+	ccgSubSurf__calcSubdivLevels(ss,
+	                             effectedV, effectedE, effectedF,
+	                             numEffectedV, numEffectedE, numEffectedF, lvl, ss->subdivLevels, 0);
 
 	for (i = 0; i < numEffectedV; i++)
-		effectedV[i]->flags = 0;
+		effectedV[i]->flags &= Vert_eSeam;
 	for (i = 0; i < numEffectedE; i++)
 		effectedE[i]->flags = 0;
 	for (i = 0; i < numEffectedF; i++)
@@ -3490,6 +5288,8 @@ CCGError ccgSubSurf_updateLevels(CCGSubSurf *ss, int lvl, CCGFace **effectedF, i
 	MEM_freeN(effectedV);
 	if (freeF) MEM_freeN(effectedF);
 
+	ccgSubSurf__endEval(ss);
+
 	return eCCGError_None;
 }
 
@@ -3705,7 +5505,8 @@ int ccgSubSurf_getFaceAge(CCGSubSurf *ss, CCGFace *f)
 void *ccgSubSurf_getFaceUserData(CCGSubSurf *ss, CCGFace *f)
 {
 	int maxGridSize = ccg_gridsize(ss->subdivLevels);
-	return FACE_getCenterData(f) + ss->meshIFC.vertDataSize * (1 + f->numVerts * maxGridSize + f->numVerts * maxGridSize * maxGridSize);
+	return FACE_getCenterData(f) + ss->meshIFC.vertDataSize * (1 + f->numVerts * maxGridSize + f->numVerts * maxGridSize * maxGridSize +
+	                                                           f->numVerts * ccg_gridbase(ss->subdivLevels));
 }
 int ccgSubSurf_getFaceNumVerts(CCGFace *f)
 {
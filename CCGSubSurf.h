@@ -40,6 +40,7 @@ typedef struct CCGMeshIFC {
 	int			numLayers;
 	int			vertDataSize;
 	int			simpleSubdiv;
+	int			denseHandles;	/* handles are SET_INT_IN_POINTER of small non-negative indices */
 } CCGMeshIFC;
 
 /***/
@@ -64,7 +65,15 @@ typedef enum {
 
 /***/
 
-#define CCG_OMP_LIMIT	1000000
+/* grid samples of work per thread of a pass, the tests build with a lower one */
+#ifndef CCG_OMP_LIMIT
+#define CCG_OMP_LIMIT	(1 << 16)
+#endif
+/* bytes of face data refined through several levels at once, the benchmark
+ * builds with INT_MAX to go level by level */
+#ifndef CCG_TILE_SIZE
+#define CCG_TILE_SIZE	(1 << 20)
+#endif
 
 /***/
 
@@ -83,6 +92,14 @@ CCGError	ccgSubSurf_syncEdgeDel	(CCGSubSurf *ss, CCGEdgeHDL eHDL);
 CCGError	ccgSubSurf_syncFaceDel	(CCGSubSurf *ss, CCGFaceHDL fHDL);
 
 CCGError	ccgSubSurf_processSync	(CCGSubSurf *ss);
+CCGError	ccgSubSurf_updatePositions	(CCGSubSurf *ss, const float (*vertCos)[3], int numVerts);
+/* element i gets handle i. A topology change replaces the edges and faces
+ * whose vertices, edges or crease changed, as a full sync does, the other
+ * elements keep their pointers, ages and levels */
+CCGError	ccgSubSurf_syncMesh		(CCGSubSurf *ss,
+									 const void *vertData, int vertStride, int numVerts,
+									 const int (*edgeVerts)[2], const float *edgeCreases, int numEdges,
+									 const int *faceOffsets, const int *faceVerts, int numFaces);
 
 CCGError	ccgSubSurf_updateFromFaces(CCGSubSurf *ss, int lvl, CCGFace **faces, int numFaces);
 CCGError	ccgSubSurf_updateToFaces(CCGSubSurf *ss, int lvl, CCGFace **faces, int numFaces);
@@ -102,6 +119,15 @@ CCGError	ccgSubSurf_setCalcVertexNormals		(CCGSubSurf *ss, int useVertNormals, i
 void		ccgSubSurf_setAllocMask				(CCGSubSurf *ss, int allocMask, int maskOffset);
 
 void		ccgSubSurf_setNumLayers				(CCGSubSurf *ss, int numLayers);
+void		ccgSubSurf_setLazyNormals			(CCGSubSurf *ss, int lazyNormals);
+CCGError	ccgSubSurf_evalNormals				(CCGSubSurf *ss);
+void		ccgSubSurf_setNumThreads			(CCGSubSurf *ss, int numThreads);
+
+#ifdef WITH_CCG_TEAM_COUNT
+/* passes that ran on a team of threads and passes with work that ran on one
+ * thread although more were allowed, counted for the tests */
+extern int ccg_numTeamPasses, ccg_numSerialPasses;
+#endif
 
 /***/
 
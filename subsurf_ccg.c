@@ -83,6 +83,7 @@ extern GLubyte stipple_quarttone[128]; /* glutil.c, bad level data */
 
 static ThreadRWMutex loops_cache_rwlock = BLI_RWLOCK_INITIALIZER;
 static ThreadRWMutex origindex_cache_rwlock = BLI_RWLOCK_INITIALIZER;
+static ThreadRWMutex normals_cache_rwlock = BLI_RWLOCK_INITIALIZER;
 
 static CCGDerivedMesh *getCCGDerivedMesh(CCGSubSurf *ss,
                                          int drawInteriorEdges,
@@ -168,6 +169,8 @@ static CCGSubSurf *_getSubSurf(CCGSubSurf *prevSS, int subdivLevels,
 	if (flags & CCG_ALLOC_MASK)
 		ifc.vertDataSize += sizeof(float);
 	ifc.simpleSubdiv = !!(flags & CCG_SIMPLE_SUBDIV);
+	/* all syncs below use mesh indices (or loop indices for UVs) */
+	ifc.denseHandles = 1;
 
 	if (useArena) {
 		CCGAllocatorIFC allocatorIFC;
@@ -194,10 +197,14 @@ static CCGSubSurf *_getSubSurf(CCGSubSurf *prevSS, int subdivLevels,
 		ccgSubSurf_setAllocMask(ccgSS, 1, sizeof(float) * numLayers);
 	}
 	
-	if (flags & CCG_CALC_NORMALS)
+	if (flags & CCG_CALC_NORMALS) {
 		ccgSubSurf_setCalcVertexNormals(ccgSS, 1, normalOffset);
-	else
+		/* the readers of the normals ask for them, see ccgdm_ensure_normals */
+		ccgSubSurf_setLazyNormals(ccgSS, 1);
+	}
+	else {
 		ccgSubSurf_setCalcVertexNormals(ccgSS, 0, 0);
+	}
 
 	return ccgSS;
 }
@@ -571,101 +578,104 @@ static void ss_sync_from_derivedmesh(CCGSubSurf *ss, DerivedMesh *dm,
                                      float (*vertexCos)[3], int useFlatSubdiv)
 {
 	float creaseFactor = (float) ccgSubSurf_getSubdivisionLevels(ss);
-#ifndef USE_DYNSIZE
-	CCGVertHDL *fVerts = NULL;
-	BLI_array_declare(fVerts);
-#endif
 	MVert *mvert = dm->getVertArray(dm);
 	MEdge *medge = dm->getEdgeArray(dm);
-	/* MFace *mface = dm->getTessFaceArray(dm); */ /* UNUSED */
-	MVert *mv;
-	MEdge *me;
-	MLoop *mloop = dm->getLoopArray(dm), *ml;
-	MPoly *mpoly = dm->getPolyArray(dm), *mp;
-	/*MFace *mf;*/ /*UNUSED*/
+	MLoop *mloop = dm->getLoopArray(dm);
+	MPoly *mpoly = dm->getPolyArray(dm);
 	int totvert = dm->getNumVerts(dm);
 	int totedge = dm->getNumEdges(dm);
-	/*int totface = dm->getNumTessFaces(dm);*/ /*UNUSED*/
-	/*int totpoly = dm->getNumFaces(dm);*/ /*UNUSED*/
-	int i, j;
+	int totpoly = dm->numPolyData;
+	int (*edgeVerts)[2];
+	float *edgeCreases;
+	int *faceOffsets, *faceVerts;
+	int i, j, totloop = 0;
 	int *index;
+	CCGError err;
 
-	ccgSubSurf_initFullSync(ss);
+	/* the loops of a poly need not follow the previous poly, so the
+	 * corners are gathered into one run per face */
+	for (i = 0; i < totpoly; i++)
+		totloop += mpoly[i].totloop;
 
-	mv = mvert;
-	index = (int *)dm->getVertDataArray(dm, CD_ORIGINDEX);
-	for (i = 0; i < totvert; i++, mv++) {
-		CCGVert *v;
+	edgeVerts = MEM_mallocN(sizeof(*edgeVerts) * MAX2(totedge, 1), "ss_sync edgeVerts");
+	edgeCreases = MEM_mallocN(sizeof(*edgeCreases) * MAX2(totedge, 1), "ss_sync edgeCreases");
+	faceOffsets = MEM_mallocN(sizeof(*faceOffsets) * (totpoly + 1), "ss_sync faceOffsets");
+	faceVerts = MEM_mallocN(sizeof(*faceVerts) * MAX2(totloop, 1), "ss_sync faceVerts");
 
-		if (vertexCos) {
-			ccgSubSurf_syncVert(ss, SET_INT_IN_POINTER(i), vertexCos[i], 0, &v);
-		}
-		else {
-			ccgSubSurf_syncVert(ss, SET_INT_IN_POINTER(i), mv->co, 0, &v);
-		}
+	for (i = 0; i < totedge; i++) {
+		MEdge *me = &medge[i];
 
-		((int *)ccgSubSurf_getVertUserData(ss, v))[1] = (index) ? *index++ : i;
+		edgeVerts[i][0] = me->v1;
+		edgeVerts[i][1] = me->v2;
+		edgeCreases[i] = useFlatSubdiv ? creaseFactor :
+		                 me->crease * creaseFactor / 255.0f;
 	}
 
-	me = medge;
-	index = (int *)dm->getEdgeDataArray(dm, CD_ORIGINDEX);
-	for (i = 0; i < totedge; i++, me++) {
-		CCGEdge *e;
-		float crease;
-
-		crease = useFlatSubdiv ? creaseFactor :
-		         me->crease * creaseFactor / 255.0f;
+	faceOffsets[0] = 0;
+	for (i = 0; i < totpoly; i++) {
+		MPoly *mp = &mpoly[i];
+		MLoop *ml = mloop + mp->loopstart;
+		int *fv = faceVerts + faceOffsets[i];
 
-		ccgSubSurf_syncEdge(ss, SET_INT_IN_POINTER(i), SET_UINT_IN_POINTER(me->v1),
-		                    SET_UINT_IN_POINTER(me->v2), crease, &e);
+		for (j = 0; j < mp->totloop; j++, ml++) {
+			fv[j] = ml->v;
+		}
+		faceOffsets[i + 1] = faceOffsets[i] + mp->totloop;
+	}
 
-		((int *)ccgSubSurf_getEdgeUserData(ss, e))[1] = (index) ? *index++ : i;
+	if (vertexCos) {
+		err = ccgSubSurf_syncMesh(ss, vertexCos, sizeof(*vertexCos), totvert,
+		                          (const int (*)[2])edgeVerts, edgeCreases, totedge,
+		                          faceOffsets, faceVerts, totpoly);
+	}
+	else {
+		err = ccgSubSurf_syncMesh(ss, mvert->co, sizeof(*mvert), totvert,
+		                          (const int (*)[2])edgeVerts, edgeCreases, totedge,
+		                          faceOffsets, faceVerts, totpoly);
 	}
 
-	mp = mpoly;
-	index = (int *)dm->getPolyDataArray(dm, CD_ORIGINDEX);
-	for (i = 0; i < dm->numPolyData; i++, mp++) {
-		CCGFace *f;
+	MEM_freeN(edgeVerts);
+	MEM_freeN(edgeCreases);
+	MEM_freeN(faceOffsets);
+	MEM_freeN(faceVerts);
 
-#ifdef USE_DYNSIZE
-		CCGVertHDL fVerts[mp->totloop];
-#else
-		BLI_array_empty(fVerts);
-		BLI_array_grow_items(fVerts, mp->totloop);
-#endif
+	/* this is very bad, means mesh is internally inconsistent.
+	 * it is not really possible to continue without modifying
+	 * other parts of code significantly to handle missing faces.
+	 * since this really shouldn't even be possible we just bail.*/
+	if (err != eCCGError_None) {
+		static int hasGivenError = 0;
 
-		ml = mloop + mp->loopstart;
-		for (j = 0; j < mp->totloop; j++, ml++) {
-			fVerts[j] = SET_UINT_IN_POINTER(ml->v);
+		if (!hasGivenError) {
+			//XXX error("Unrecoverable error in SubSurf calculation,"
+			//      " mesh is inconsistent.");
+
+			hasGivenError = 1;
 		}
 
-		/* this is very bad, means mesh is internally inconsistent.
-		 * it is not really possible to continue without modifying
-		 * other parts of code significantly to handle missing faces.
-		 * since this really shouldn't even be possible we just bail.*/
-		if (ccgSubSurf_syncFace(ss, SET_INT_IN_POINTER(i), mp->totloop,
-		                        fVerts, &f) == eCCGError_InvalidValue)
-		{
-			static int hasGivenError = 0;
+		return;
+	}
 
-			if (!hasGivenError) {
-				//XXX error("Unrecoverable error in SubSurf calculation,"
-				//      " mesh is inconsistent.");
+	index = (int *)dm->getVertDataArray(dm, CD_ORIGINDEX);
+	for (i = 0; i < totvert; i++) {
+		CCGVert *v = ccgSubSurf_getVert(ss, SET_INT_IN_POINTER(i));
 
-				hasGivenError = 1;
-			}
+		((int *)ccgSubSurf_getVertUserData(ss, v))[1] = (index) ? index[i] : i;
+	}
 
-			return;
-		}
+	index = (int *)dm->getEdgeDataArray(dm, CD_ORIGINDEX);
+	for (i = 0; i < totedge; i++) {
+		CCGEdge *e = ccgSubSurf_getEdge(ss, SET_INT_IN_POINTER(i));
 
-		((int *)ccgSubSurf_getFaceUserData(ss, f))[1] = (index) ? *index++ : i;
+		((int *)ccgSubSurf_getEdgeUserData(ss, e))[1] = (index) ? index[i] : i;
 	}
 
-	ccgSubSurf_processSync(ss);
+	index = (int *)dm->getPolyDataArray(dm, CD_ORIGINDEX);
+	for (i = 0; i < totpoly; i++) {
+		CCGFace *f = ccgSubSurf_getFace(ss, SET_INT_IN_POINTER(i));
 
-#ifndef USE_DYNSIZE
-	BLI_array_free(fVerts);
-#endif
+		((int *)ccgSubSurf_getFaceUserData(ss, f))[1] = (index) ? index[i] : i;
+	}
 }
 
 /***/
@@ -695,6 +705,27 @@ static void minmax_v3_v3v3(const float vec[3], float min[3], float max[3])
 	if (max[2] < vec[2]) max[2] = vec[2];
 }
 
+/* The syncs leave the normals out, see ccgSubSurf_setLazyNormals. The first
+ * reader of the DM that needs them calculates them, once for all threads */
+static void ccgdm_ensure_normals(CCGDerivedMesh *ccgdm)
+{
+	int normalsDone;
+
+	BLI_rw_mutex_lock(&normals_cache_rwlock, THREAD_LOCK_READ);
+	normalsDone = ccgdm->normalsDone;
+	BLI_rw_mutex_unlock(&normals_cache_rwlock);
+
+	if (normalsDone)
+		return;
+
+	BLI_rw_mutex_lock(&normals_cache_rwlock, THREAD_LOCK_WRITE);
+	if (!ccgdm->normalsDone) {
+		ccgSubSurf_evalNormals(ccgdm->ss);
+		ccgdm->normalsDone = 1;
+	}
+	BLI_rw_mutex_unlock(&normals_cache_rwlock);
+}
+
 static void ccgDM_getMinMax(DerivedMesh *dm, float r_min[3], float r_max[3])
 {
 	CCGDerivedMesh *ccgdm = (CCGDerivedMesh *) dm;
@@ -781,6 +812,7 @@ static void ccgDM_getFinalVert(DerivedMesh *dm, int vertNum, MVert *mv)
 	int i;
 
 	CCG_key_top_level(&key, ss);
+	ccgdm_ensure_normals(ccgdm);
 	memset(mv, 0, sizeof(*mv));
 
 	if ((vertNum < ccgdm->edgeMap[0].startVert) && (ccgSubSurf_getNumFaces(ss) > 0)) {
@@ -1145,6 +1177,7 @@ static void ccgDM_copyFinalVertArray(DerivedMesh *dm, MVert *mvert)
 	unsigned int i = 0;
 
 	CCG_key_top_level(&key, ss);
+	ccgdm_ensure_normals(ccgdm);
 
 	totface = ccgSubSurf_getNumFaces(ss);
 	for (index = 0; index < totface; index++) {
@@ -1703,6 +1736,9 @@ static void ccgDM_foreachMappedVert(
 	CCGKey key;
 	CCG_key_top_level(&key, ccgdm->ss);
 
+	if (flag & DM_FOREACH_USE_NORMAL)
+		ccgdm_ensure_normals(ccgdm);
+
 	for (vi = ccgSubSurf_getVertIterator(ccgdm->ss); !ccgVertIterator_isStopped(vi); ccgVertIterator_next(vi)) {
 		CCGVert *v = ccgVertIterator_getCurrent(vi);
 		const int index = ccgDM_getVertMapIndex(ccgdm->ss, v);
@@ -1959,6 +1995,7 @@ static void ccgDM_drawFacesSolid(DerivedMesh *dm, float (*partial_redraw_planes)
 	int drawcurrent = 0, matnr = -1, shademodel = -1;
 
 	CCG_key_top_level(&key, ss);
+	ccgdm_ensure_normals(ccgdm);
 	ccgdm_pbvh_update(ccgdm);
 
 	if (ccgdm->pbvh && ccgdm->multires.mmd && !fast) {
@@ -2149,6 +2186,7 @@ static void ccgDM_drawMappedFacesGLSL(DerivedMesh *dm,
 	int a, i, do_draw, numVerts, matnr, new_matnr, totface;
 
 	CCG_key_top_level(&key, ss);
+	ccgdm_ensure_normals(ccgdm);
 	ccgdm_pbvh_update(ccgdm);
 
 	do_draw = 0;
@@ -2321,6 +2359,7 @@ static void ccgDM_drawMappedFacesMat(DerivedMesh *dm,
 	int a, i, numVerts, matnr, new_matnr, totface;
 
 	CCG_key_top_level(&key, ss);
+	ccgdm_ensure_normals(ccgdm);
 	ccgdm_pbvh_update(ccgdm);
 
 	matnr = -1;
@@ -2490,6 +2529,7 @@ static void ccgDM_drawFacesTex_common(DerivedMesh *dm,
 	(void) compareDrawOptions;
 
 	CCG_key_top_level(&key, ss);
+	ccgdm_ensure_normals(ccgdm);
 	ccgdm_pbvh_update(ccgdm);
 
 	if (!mcol)
@@ -2731,6 +2771,7 @@ static void ccgDM_drawMappedFaces(DerivedMesh *dm,
 	int gridFaces = gridSize - 1, totface;
 
 	CCG_key_top_level(&key, ss);
+	ccgdm_ensure_normals(ccgdm);
 
 	/* currently unused -- each original face is handled separately */
 	(void)compareDrawOptions;
@@ -2969,6 +3010,9 @@ static void ccgDM_foreachMappedFaceCenter(
 
 	CCG_key_top_level(&key, ss);
 
+	if (flag & DM_FOREACH_USE_NORMAL)
+		ccgdm_ensure_normals(ccgdm);
+
 	for (fi = ccgSubSurf_getFaceIterator(ss); !ccgFaceIterator_isStopped(fi); ccgFaceIterator_next(fi)) {
 		CCGFace *f = ccgFaceIterator_getCurrent(fi);
 		const int index = ccgDM_getFaceMapIndex(ss, f);
@@ -3368,6 +3412,9 @@ static void ccgdm_create_grids(DerivedMesh *dm)
 	int *gridOffset;
 	int index, numFaces, numGrids, S, gIndex /*, gridSize*/;
 
+	/* the grids are read with their normals, by the PBVH among others */
+	ccgdm_ensure_normals(ccgdm);
+
 	if (ccgdm->gridData)
 		return;
 	
@@ -3567,7 +3614,8 @@ static void ccgDM_recalcTessellation(DerivedMesh *UNUSED(dm))
 
 static void ccgDM_calcNormals(DerivedMesh *dm)
 {
-	/* Nothing to do: CCG calculates normals during drawing */
+	/* CCG calculates the normals the syncs left out when they are read */
+	ccgdm_ensure_normals((CCGDerivedMesh *) dm);
 	dm->dirty &= ~DM_DIRTY_NORMALS;
 }
 
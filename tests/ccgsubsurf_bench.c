@@ -0,0 +1,144 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ */
+
+/* Timing of a full sync of CCGSubSurf, built by hand like ccgsubsurf_test.c
+ * from the top of a Blender source tree:
+ *
+ *   cc -O2 -fopenmp -Iintern/guardedalloc -Isource/blender/blenlib \
+ *      -Isource/blender/blenkernel -Isource/blender/makesdna \
+ *      -Isource/blender/blenkernel/intern \
+ *      source/blender/blenkernel/intern/tests/ccgsubsurf_bench.c \
+ *      source/blender/blenkernel/intern/CCGSubSurf.c \
+ *      <build>/lib/libbf_intern_guardedalloc.a -lm -o ccgsubsurf_bench
+ *
+ * and once more with -DCCG_TILE_SIZE=INT_MAX to refine level by level, for
+ * comparing the tiled refinement against it. Run as
+ *
+ *   ccgsubsurf_bench <grid size> <levels> <threads>
+ *
+ * which syncs a grid of quads with vertex normals, a wave in z so the
+ * normals differ, and prints the best of several syncs after a warm up. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <math.h>
+#include <time.h>
+
+#include "MEM_guardedalloc.h"
+#include "BLI_utildefines.h"
+
+#include "CCGSubSurf.h"
+
+#define NUM_RUNS 5
+
+static double time_now(void)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void full_sync(CCGSubSurf *ss, float (*vertCos)[3], int M)
+{
+	int NV = M + 1, x, y, i;
+
+	ccgSubSurf_initFullSync(ss);
+	for (i = 0; i < NV * NV; i++)
+		ccgSubSurf_syncVert(ss, SET_INT_IN_POINTER(i), vertCos[i], 0, NULL);
+	for (y = 0; y < NV; y++) {
+		for (x = 0; x < NV; x++) {
+			int v = y * NV + x;
+
+			if (x < M) {
+				ccgSubSurf_syncEdge(ss, SET_INT_IN_POINTER(2 * v), SET_INT_IN_POINTER(v),
+				                    SET_INT_IN_POINTER(v + 1), 0.0f, NULL);
+			}
+			if (y < M) {
+				ccgSubSurf_syncEdge(ss, SET_INT_IN_POINTER(2 * v + 1), SET_INT_IN_POINTER(v),
+				                    SET_INT_IN_POINTER(v + NV), 0.0f, NULL);
+			}
+		}
+	}
+	for (y = 0; y < M; y++) {
+		for (x = 0; x < M; x++) {
+			int v = y * NV + x;
+			CCGVertHDL vHDLs[4];
+
+			vHDLs[0] = SET_INT_IN_POINTER(v);
+			vHDLs[1] = SET_INT_IN_POINTER(v + 1);
+			vHDLs[2] = SET_INT_IN_POINTER(v + NV + 1);
+			vHDLs[3] = SET_INT_IN_POINTER(v + NV);
+			ccgSubSurf_syncFace(ss, SET_INT_IN_POINTER(y * M + x), 4, vHDLs, NULL);
+		}
+	}
+	ccgSubSurf_processSync(ss);
+}
+
+int main(int argc, char **argv)
+{
+	CCGMeshIFC ifc = {4, 4, 4, 3, sizeof(float) * 6, 0, 0};
+	CCGSubSurf *ss;
+	float (*vertCos)[3];
+	double best = 0.0;
+	int M, NV, levels, numThreads, run, x, y;
+
+	if (argc != 4) {
+		printf("usage: %s <grid size> <levels> <threads>\n", argv[0]);
+		return 1;
+	}
+	M = atoi(argv[1]);
+	levels = atoi(argv[2]);
+	numThreads = atoi(argv[3]);
+	NV = M + 1;
+
+	vertCos = MEM_mallocN(sizeof(*vertCos) * NV * NV, "bench vertCos");
+	ss = ccgSubSurf_new(&ifc, levels, NULL, NULL);
+	ccgSubSurf_setCalcVertexNormals(ss, 1, sizeof(float) * 3);
+	ccgSubSurf_setNumThreads(ss, numThreads);
+
+	/* the first run is the warm up, it also allocates the levels */
+	for (run = 0; run <= NUM_RUNS; run++) {
+		double start;
+
+		for (y = 0; y < NV; y++) {
+			for (x = 0; x < NV; x++) {
+				float *co = vertCos[y * NV + x];
+
+				co[0] = x;
+				co[1] = y;
+				co[2] = 0.3f * sinf(x * 1.1f + run) * cosf(y * 0.7f);
+			}
+		}
+
+		start = time_now();
+		full_sync(ss, vertCos, M);
+		if (run > 0 && (run == 1 || time_now() - start < best))
+			best = time_now() - start;
+	}
+
+	printf("%dx%d level %d, %d threads, tile size %d: %.1f ms\n",
+	       M, M, levels, numThreads, CCG_TILE_SIZE, best * 1e3);
+
+	ccgSubSurf_free(ss);
+	MEM_freeN(vertCos);
+	return 0;
+}
@@ -0,0 +1,575 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ */
+
+/* Regression tests of CCGSubSurf. There is no build target for them, they
+ * are built by hand together with CCGSubSurf.c, from the top of a Blender
+ * source tree with this directory at source/blender/blenkernel/intern:
+ *
+ *   cc -O2 -fopenmp -DCCG_OMP_LIMIT=1 -DWITH_CCG_TEAM_COUNT \
+ *      -Iintern/guardedalloc -Isource/blender/blenlib \
+ *      -Isource/blender/blenkernel -Isource/blender/makesdna \
+ *      -Isource/blender/blenkernel/intern \
+ *      source/blender/blenkernel/intern/tests/ccgsubsurf_test.c \
+ *      source/blender/blenkernel/intern/CCGSubSurf.c \
+ *      <build>/lib/libbf_intern_guardedalloc.a -lm -o ccgsubsurf_test
+ *
+ * -fopenmp may be left out together with the two defines, the thread tests
+ * then only run one thread. With OpenMP every pass with work must get a team,
+ * CCG_OMP_LIMIT=1 gives every pass more than one thread and the counts of
+ * WITH_CCG_TEAM_COUNT check that it did. The program prints each failure and
+ * returns the number of failed tests. */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "MEM_guardedalloc.h"
+#include "BLI_utildefines.h"
+
+#include "CCGSubSurf.h"
+
+#ifdef _OPENMP
+#  include <omp.h>
+#  if !defined(WITH_CCG_TEAM_COUNT) || CCG_OMP_LIMIT > 1
+#    error "build the tests with -DCCG_OMP_LIMIT=1 -DWITH_CCG_TEAM_COUNT"
+#  endif
+#endif
+
+#define N 32
+#define NUM_VERTS (N * N)
+#define NUM_FACES ((N - 1) * (N - 1))
+#define LEVELS 3
+
+static float vertCos[NUM_VERTS][3];
+
+static void build_grid(void)
+{
+	int x, y;
+
+	for (y = 0; y < N; y++) {
+		for (x = 0; x < N; x++) {
+			vertCos[y * N + x][0] = (float) x;
+			vertCos[y * N + x][1] = (float) y;
+			vertCos[y * N + x][2] = 0.3f * sinf(x * 1.1f) * cosf(y * 0.7f);
+		}
+	}
+}
+
+static void face_verts(int i, CCGVertHDL vHDLs[4])
+{
+	int x = i % (N - 1), y = i / (N - 1);
+
+	vHDLs[0] = SET_INT_IN_POINTER(y * N + x);
+	vHDLs[1] = SET_INT_IN_POINTER(y * N + x + 1);
+	vHDLs[2] = SET_INT_IN_POINTER((y + 1) * N + x + 1);
+	vHDLs[3] = SET_INT_IN_POINTER((y + 1) * N + x);
+}
+
+/* edges are keyed by their lower vertex, twice that for +x and plus one for +y */
+static void sync_edges(CCGSubSurf *ss)
+{
+	int x, y;
+
+	for (y = 0; y < N; y++) {
+		for (x = 0; x < N; x++) {
+			int v = y * N + x;
+
+			if (x < N - 1)
+				ccgSubSurf_syncEdge(ss, SET_INT_IN_POINTER(2 * v), SET_INT_IN_POINTER(v), SET_INT_IN_POINTER(v + 1), 0.0f, NULL);
+			if (y < N - 1)
+				ccgSubSurf_syncEdge(ss, SET_INT_IN_POINTER(2 * v + 1), SET_INT_IN_POINTER(v), SET_INT_IN_POINTER(v + N), 0.0f, NULL);
+		}
+	}
+}
+
+static CCGSubSurf *new_subsurf(void)
+{
+	CCGMeshIFC ifc;
+	CCGSubSurf *ss;
+
+	ifc.vertUserSize = ifc.edgeUserSize = ifc.faceUserSize = 4;
+	ifc.numLayers = 3;
+	ifc.vertDataSize = sizeof(float) * 6;
+	ifc.simpleSubdiv = 0;
+	ifc.denseHandles = 0;
+
+	ss = ccgSubSurf_new(&ifc, LEVELS, NULL, NULL);
+	ccgSubSurf_setCalcVertexNormals(ss, 1, sizeof(float) * 3);
+	return ss;
+}
+
+/* full sync of the grid without the face skipFace, -1 for all faces */
+static void full_sync(CCGSubSurf *ss, int skipFace)
+{
+	int i;
+
+	ccgSubSurf_initFullSync(ss);
+	for (i = 0; i < NUM_VERTS; i++)
+		ccgSubSurf_syncVert(ss, SET_INT_IN_POINTER(i), vertCos[i], 0, NULL);
+	sync_edges(ss);
+	for (i = 0; i < NUM_FACES; i++) {
+		CCGVertHDL vHDLs[4];
+
+		if (i == skipFace)
+			continue;
+		face_verts(i, vHDLs);
+		ccgSubSurf_syncFace(ss, SET_INT_IN_POINTER(i), 4, vHDLs, NULL);
+	}
+	ccgSubSurf_processSync(ss);
+}
+
+/* the finest grids and normals of every face but skipFace are the same, up
+ * to the order the normals around a vertex are added up in */
+static int compare_grids(CCGSubSurf *ss, CCGSubSurf *ref, int skipFace)
+{
+	int gridSize = ccgSubSurf_getGridSize(ref);
+	int i, j, S, x, y;
+
+	for (i = 0; i < NUM_FACES; i++) {
+		CCGFace *f, *fRef;
+
+		if (i == skipFace)
+			continue;
+		f = ccgSubSurf_getFace(ss, SET_INT_IN_POINTER(i));
+		fRef = ccgSubSurf_getFace(ref, SET_INT_IN_POINTER(i));
+		if (!f || !fRef)
+			return 0;
+
+		for (S = 0; S < 4; S++) {
+			for (y = 0; y < gridSize; y++) {
+				for (x = 0; x < gridSize; x++) {
+					float *co = ccgSubSurf_getFaceGridData(ss, f, S, x, y);
+					float *coRef = ccgSubSurf_getFaceGridData(ref, fRef, S, x, y);
+
+					for (j = 0; j < 6; j++) {
+						if (fabsf(co[j] - coRef[j]) > 1e-5f)
+							return 0;
+					}
+				}
+			}
+		}
+	}
+	return 1;
+}
+
+/* A partial sync that deletes a face after a lazy sync must not leave the
+ * deleted face in the elements waiting for their normals. */
+static int test_partial_face_delete_lazy(int lazyNormals)
+{
+	CCGSubSurf *ss = new_subsurf(), *ref = new_subsurf();
+	int delFace = NUM_FACES / 2, ok;
+
+	ccgSubSurf_setLazyNormals(ss, lazyNormals);
+	full_sync(ss, -1);
+
+	ccgSubSurf_initPartialSync(ss);
+	ccgSubSurf_syncFaceDel(ss, SET_INT_IN_POINTER(delFace));
+	ccgSubSurf_processSync(ss);
+
+	/* and a sync after it, which takes over the pending elements */
+	vertCos[1][2] += 0.25f;
+	ccgSubSurf_initPartialSync(ss);
+	ccgSubSurf_syncVert(ss, SET_INT_IN_POINTER(1), vertCos[1], 0, NULL);
+	ccgSubSurf_processSync(ss);
+
+	ccgSubSurf_evalNormals(ss);
+
+	full_sync(ref, delFace);
+	ok = compare_grids(ss, ref, delFace);
+	vertCos[1][2] -= 0.25f;
+
+	ccgSubSurf_free(ss);
+	ccgSubSurf_free(ref);
+	return ok;
+}
+
+/* updatePositions rejects what it can't index or copy and leaves the
+ * vertices alone then, and matches a full sync otherwise. */
+static int test_update_positions(void)
+{
+	CCGSubSurf *ss = new_subsurf(), *ref = new_subsurf();
+	int i, ok = 1;
+
+	/* the handles of the vertices go past the array */
+	ccgSubSurf_initFullSync(ss);
+	for (i = 0; i < NUM_VERTS; i++)
+		ccgSubSurf_syncVert(ss, SET_INT_IN_POINTER(i + 1), vertCos[i], 0, NULL);
+	ccgSubSurf_processSync(ss);
+	if (ccgSubSurf_updatePositions(ss, (const float (*)[3]) vertCos, NUM_VERTS) != eCCGError_InvalidValue)
+		ok = 0;
+	if (memcmp(ccgSubSurf_getVertData(ss, ccgSubSurf_getVert(ss, SET_INT_IN_POINTER(1))), vertCos[0], sizeof(vertCos[0])))
+		ok = 0;
+
+	full_sync(ss, -1);
+	if (ccgSubSurf_updatePositions(ss, (const float (*)[3]) vertCos, NUM_VERTS - 1) != eCCGError_InvalidValue)
+		ok = 0;
+
+	ccgSubSurf_setNumLayers(ss, 4);
+	if (ccgSubSurf_updatePositions(ss, (const float (*)[3]) vertCos, NUM_VERTS) != eCCGError_InvalidValue)
+		ok = 0;
+	ccgSubSurf_setNumLayers(ss, 3);
+
+	vertCos[N + 1][2] += 0.25f;
+	if (ccgSubSurf_updatePositions(ss, (const float (*)[3]) vertCos, NUM_VERTS) != eCCGError_None)
+		ok = 0;
+	full_sync(ref, -1);
+	if (!compare_grids(ss, ref, -1))
+		ok = 0;
+	vertCos[N + 1][2] -= 0.25f;
+
+	ccgSubSurf_free(ss);
+	ccgSubSurf_free(ref);
+	return ok;
+}
+
+/* A syncMesh that drops a face keeps the other faces and matches a syncMesh
+ * of the smaller mesh into an empty one. */
+static int test_sync_mesh_keeps_elements(void)
+{
+	static int edgeVerts[2 * NUM_VERTS][2], faceOffsets[NUM_FACES + 1], faceVerts[4 * NUM_FACES];
+	static float edgeCreases[2 * NUM_VERTS];
+	CCGSubSurf *ss = new_subsurf(), *ref = new_subsurf();
+	CCGFace *f;
+	int i, S, x, y, numEdges = 0, lastFace = NUM_FACES - 1, ok = 1;
+
+	for (y = 0; y < N; y++) {
+		for (x = 0; x < N; x++) {
+			int v = y * N + x;
+
+			if (x < N - 1) {
+				edgeVerts[numEdges][0] = v;
+				edgeVerts[numEdges][1] = v + 1;
+				edgeCreases[numEdges++] = 0.0f;
+			}
+			if (y < N - 1) {
+				edgeVerts[numEdges][0] = v;
+				edgeVerts[numEdges][1] = v + N;
+				edgeCreases[numEdges++] = 0.0f;
+			}
+		}
+	}
+	for (i = 0; i < NUM_FACES; i++) {
+		CCGVertHDL vHDLs[4];
+
+		face_verts(i, vHDLs);
+		faceOffsets[i] = 4 * i;
+		for (S = 0; S < 4; S++)
+			faceVerts[4 * i + S] = GET_INT_FROM_POINTER(vHDLs[S]);
+	}
+	faceOffsets[NUM_FACES] = 4 * NUM_FACES;
+
+	ccgSubSurf_syncMesh(ss, vertCos, sizeof(vertCos[0]), NUM_VERTS,
+	                    (const int (*)[2]) edgeVerts, edgeCreases, numEdges, faceOffsets, faceVerts, NUM_FACES);
+	f = ccgSubSurf_getFace(ss, SET_INT_IN_POINTER(0));
+
+	if (ccgSubSurf_syncMesh(ss, vertCos, sizeof(vertCos[0]), NUM_VERTS,
+	                        (const int (*)[2]) edgeVerts, edgeCreases, numEdges,
+	                        faceOffsets, faceVerts, lastFace) != eCCGError_None)
+	{
+		ok = 0;
+	}
+	if (ccgSubSurf_getFace(ss, SET_INT_IN_POINTER(0)) != f || ccgSubSurf_getFace(ss, SET_INT_IN_POINTER(lastFace)))
+		ok = 0;
+
+	ccgSubSurf_syncMesh(ref, vertCos, sizeof(vertCos[0]), NUM_VERTS,
+	                    (const int (*)[2]) edgeVerts, edgeCreases, numEdges, faceOffsets, faceVerts, lastFace);
+	if (!compare_grids(ss, ref, lastFace))
+		ok = 0;
+
+	ccgSubSurf_free(ss);
+	ccgSubSurf_free(ref);
+	return ok;
+}
+
+/* The grid with every kind of element the level 0 rules and the creases
+ * treat apart, for the thread count test: some quads are cut into two
+ * triangles, which makes the ends of the cut valence 5, some triangles are
+ * merged with the quad next to them into a 5-gon, which leaves a valence 3
+ * vertex, and a row and a column of edges are creased. */
+#define MAX_MIXED_EDGES (3 * NUM_VERTS)
+#define MAX_MIXED_FACES (2 * NUM_FACES)
+
+static int mixedEdgeVerts[MAX_MIXED_EDGES][2];
+static float mixedEdgeCreases[MAX_MIXED_EDGES];
+static int mixedFaceVerts[MAX_MIXED_FACES][5];
+static int mixedFaceNumVerts[MAX_MIXED_FACES];
+static int numMixedEdges, numMixedFaces;
+
+static void add_mixed_edge(int v0, int v1)
+{
+	int x0 = v0 % N, y0 = v0 / N, x1 = v1 % N, y1 = v1 / N;
+	float crease = 0.0f;
+
+	if (y0 == N / 2 && y1 == N / 2)
+		crease = 1.5f;
+	else if (x0 == N / 3 && x1 == N / 3)
+		crease = 0.5f;
+
+	mixedEdgeVerts[numMixedEdges][0] = v0;
+	mixedEdgeVerts[numMixedEdges][1] = v1;
+	mixedEdgeCreases[numMixedEdges++] = crease;
+}
+
+static void add_mixed_face(int numVerts, int v0, int v1, int v2, int v3, int v4)
+{
+	int *verts = mixedFaceVerts[numMixedFaces];
+
+	verts[0] = v0;
+	verts[1] = v1;
+	verts[2] = v2;
+	verts[3] = v3;
+	verts[4] = v4;
+	mixedFaceNumVerts[numMixedFaces++] = numVerts;
+}
+
+/* the cell at x, y is the quad of a 5-gon, the one right of it holds the
+ * triangle that is left over */
+static int is_pentagon_cell(int x, int y)
+{
+	return x % 4 == 1 && y % 4 == 1;
+}
+
+static void build_mixed_mesh(void)
+{
+	int x, y;
+
+	numMixedEdges = numMixedFaces = 0;
+
+	for (y = 0; y < N - 1; y++) {
+		for (x = 0; x < N - 1; x++) {
+			int v00 = y * N + x, v10 = v00 + 1, v01 = v00 + N, v11 = v01 + 1;
+
+			if (is_pentagon_cell(x, y)) {
+				add_mixed_face(5, v00, v10, v11 + 1, v11, v01);
+				add_mixed_face(3, v10, v10 + 1, v11 + 1, -1, -1);
+				add_mixed_edge(v10, v11 + 1);
+			}
+			else if (x > 0 && is_pentagon_cell(x - 1, y)) {
+				/* pass, added with the 5-gon */
+			}
+			else if (x % 4 == 3 && y % 4 == 3) {
+				add_mixed_face(3, v00, v10, v11, -1, -1);
+				add_mixed_face(3, v00, v11, v01, -1, -1);
+				add_mixed_edge(v00, v11);
+			}
+			else {
+				add_mixed_face(4, v00, v10, v11, v01, -1);
+			}
+		}
+	}
+
+	for (y = 0; y < N; y++) {
+		for (x = 0; x < N; x++) {
+			int v = y * N + x;
+
+			if (x < N - 1)
+				add_mixed_edge(v, v + 1);
+			/* the edge between the quad and the triangle of a 5-gon is gone */
+			if (y < N - 1 && !(x > 0 && is_pentagon_cell(x - 1, y)))
+				add_mixed_edge(v, v + N);
+		}
+	}
+}
+
+static void full_sync_mixed(CCGSubSurf *ss)
+{
+	int i, S;
+
+	ccgSubSurf_initFullSync(ss);
+	for (i = 0; i < NUM_VERTS; i++)
+		ccgSubSurf_syncVert(ss, SET_INT_IN_POINTER(i), vertCos[i], 0, NULL);
+	for (i = 0; i < numMixedEdges; i++) {
+		ccgSubSurf_syncEdge(ss, SET_INT_IN_POINTER(i), SET_INT_IN_POINTER(mixedEdgeVerts[i][0]),
+		                    SET_INT_IN_POINTER(mixedEdgeVerts[i][1]), mixedEdgeCreases[i], NULL);
+	}
+	for (i = 0; i < numMixedFaces; i++) {
+		CCGVertHDL vHDLs[5];
+
+		for (S = 0; S < mixedFaceNumVerts[i]; S++)
+			vHDLs[S] = SET_INT_IN_POINTER(mixedFaceVerts[i][S]);
+		ccgSubSurf_syncFace(ss, SET_INT_IN_POINTER(i), mixedFaceNumVerts[i], vHDLs, NULL);
+	}
+	ccgSubSurf_processSync(ss);
+}
+
+/* every level of the vertices and edges and the finest grids of the faces
+ * are the same to the bit, the normals on the finest level */
+static int compare_levels(CCGSubSurf *ss, CCGSubSurf *ref)
+{
+	int levels = ccgSubSurf_getSubdivisionLevels(ref);
+	int gridSize = ccgSubSurf_getGridSize(ref);
+	size_t coSize = sizeof(float) * 3, dataSize = sizeof(float) * 6;
+	CCGVertIterator *vi;
+	CCGEdgeIterator *ei;
+	CCGFaceIterator *fi;
+	int lvl, S, x, y, same = 1;
+
+	if (ccgSubSurf_getNumVerts(ss) != ccgSubSurf_getNumVerts(ref) ||
+	    ccgSubSurf_getNumEdges(ss) != ccgSubSurf_getNumEdges(ref) ||
+	    ccgSubSurf_getNumFaces(ss) != ccgSubSurf_getNumFaces(ref))
+	{
+		return 0;
+	}
+
+	for (vi = ccgSubSurf_getVertIterator(ref); same && !ccgVertIterator_isStopped(vi); ccgVertIterator_next(vi)) {
+		CCGVert *vRef = ccgVertIterator_getCurrent(vi);
+		CCGVert *v = ccgSubSurf_getVert(ss, ccgSubSurf_getVertVertHandle(vRef));
+
+		for (lvl = 0; same && lvl <= levels; lvl++) {
+			if (memcmp(ccgSubSurf_getVertLevelData(ss, v, lvl), ccgSubSurf_getVertLevelData(ref, vRef, lvl),
+			           (lvl == levels) ? dataSize : coSize))
+			{
+				same = 0;
+			}
+		}
+	}
+	ccgVertIterator_free(vi);
+
+	for (ei = ccgSubSurf_getEdgeIterator(ref); same && !ccgEdgeIterator_isStopped(ei); ccgEdgeIterator_next(ei)) {
+		CCGEdge *eRef = ccgEdgeIterator_getCurrent(ei);
+		CCGEdge *e = ccgSubSurf_getEdge(ss, ccgSubSurf_getEdgeEdgeHandle(eRef));
+
+		for (lvl = 0; same && lvl <= levels; lvl++) {
+			for (x = 0; same && x < ccgSubSurf_getEdgeLevelSize(ref, lvl); x++) {
+				if (memcmp(ccgSubSurf_getEdgeLevelData(ss, e, x, lvl), ccgSubSurf_getEdgeLevelData(ref, eRef, x, lvl),
+				           (lvl == levels) ? dataSize : coSize))
+				{
+					same = 0;
+				}
+			}
+		}
+	}
+	ccgEdgeIterator_free(ei);
+
+	for (fi = ccgSubSurf_getFaceIterator(ref); same && !ccgFaceIterator_isStopped(fi); ccgFaceIterator_next(fi)) {
+		CCGFace *fRef = ccgFaceIterator_getCurrent(fi);
+		CCGFace *f = ccgSubSurf_getFace(ss, ccgSubSurf_getFaceFaceHandle(fRef));
+
+		if (memcmp(ccgSubSurf_getFaceCenterData(f), ccgSubSurf_getFaceCenterData(fRef), coSize))
+			same = 0;
+		for (S = 0; same && S < ccgSubSurf_getFaceNumVerts(fRef); S++) {
+			for (y = 0; same && y < gridSize; y++) {
+				for (x = 0; same && x < gridSize; x++) {
+					if (memcmp(ccgSubSurf_getFaceGridData(ss, f, S, x, y), ccgSubSurf_getFaceGridData(ref, fRef, S, x, y),
+					           dataSize))
+					{
+						same = 0;
+					}
+				}
+			}
+		}
+	}
+	ccgFaceIterator_free(fi);
+
+	return same;
+}
+
+/* The result on several threads is the same as on one, after a full sync,
+ * a partial sync and a change of the levels. The tests are built with a
+ * CCG_OMP_LIMIT low enough for every pass to get a team, and that is
+ * checked too: the single thread reference doesn't count. */
+static int test_thread_count(int numThreads)
+{
+	CCGSubSurf *ss = new_subsurf(), *ref = new_subsurf();
+	int i, ok = 1;
+
+	ccgSubSurf_setNumThreads(ref, 1);
+	ccgSubSurf_setNumThreads(ss, numThreads);
+#ifdef WITH_CCG_TEAM_COUNT
+	ccg_numTeamPasses = ccg_numSerialPasses = 0;
+#endif
+
+	full_sync_mixed(ref);
+	full_sync_mixed(ss);
+	if (!compare_levels(ss, ref))
+		ok = 0;
+
+	for (i = 0; i < NUM_VERTS; i += 7)
+		vertCos[i][2] += 0.25f;
+	ccgSubSurf_initPartialSync(ref);
+	ccgSubSurf_initPartialSync(ss);
+	for (i = 0; i < NUM_VERTS; i += 7) {
+		ccgSubSurf_syncVert(ref, SET_INT_IN_POINTER(i), vertCos[i], 0, NULL);
+		ccgSubSurf_syncVert(ss, SET_INT_IN_POINTER(i), vertCos[i], 0, NULL);
+	}
+	ccgSubSurf_processSync(ref);
+	ccgSubSurf_processSync(ss);
+	for (i = 0; i < NUM_VERTS; i += 7)
+		vertCos[i][2] -= 0.25f;
+	if (!compare_levels(ss, ref))
+		ok = 0;
+
+	ccgSubSurf_setSubdivisionLevels(ref, LEVELS + 1);
+	ccgSubSurf_setSubdivisionLevels(ss, LEVELS + 1);
+	if (!compare_levels(ss, ref))
+		ok = 0;
+
+#ifdef WITH_CCG_TEAM_COUNT
+	if (ccg_numTeamPasses == 0 || ccg_numSerialPasses != 0) {
+		printf("%d passes on a team, %d on one thread\n", ccg_numTeamPasses, ccg_numSerialPasses);
+		ok = 0;
+	}
+#endif
+
+	ccgSubSurf_free(ss);
+	ccgSubSurf_free(ref);
+	return ok;
+}
+
+int main(void)
+{
+	int failed = 0, lazyNormals, numThreads;
+
+	build_grid();
+	build_mixed_mesh();
+
+#ifdef _OPENMP
+	/* the thread count test needs teams also on machines with fewer cores */
+	if (omp_get_max_threads() < 4)
+		omp_set_num_threads(4);
+#endif
+
+	for (lazyNormals = 0; lazyNormals <= 1; lazyNormals++) {
+		if (!test_partial_face_delete_lazy(lazyNormals)) {
+			printf("partial face delete, lazy normals %d: FAILED\n", lazyNormals);
+			failed++;
+		}
+	}
+
+	if (!test_update_positions()) {
+		printf("update positions: FAILED\n");
+		failed++;
+	}
+
+	if (!test_sync_mesh_keeps_elements()) {
+		printf("sync mesh topology change: FAILED\n");
+		failed++;
+	}
+
+	for (numThreads = 2; numThreads <= 4; numThreads++) {
+		if (!test_thread_count(numThreads)) {
+			printf("%d threads against 1: FAILED\n", numThreads);
+			failed++;
+		}
+	}
+
+	printf("%d failed\n", failed);
+	return failed;
+}